@@ -0,0 +1,216 @@
+// Compares benchmark results (see solver_lib/bench_results.h) against a
+// baseline, to catch a change to solver_lib that makes things slower.
+//
+// Usage: bench_compare BASELINE CURRENT [--threshold PCT]
+//
+// Typically:
+//   sudoku bench --repeat 10 --json base.json        (before the change)
+//   sudoku bench --repeat 10 --json new.json         (after)
+//   bench_compare base.json new.json
+//
+// For each benchmark in both files, this shows the mean times, the change,
+// and a 95% confidence interval for the change (Welch's t interval, which
+// doesn't assume the two builds are equally noisy).  A time is slower or
+// faster only if the whole interval is on one side of zero and the change
+// is more than the threshold (default 5%), so noise alone rarely flags
+// anything.  That takes at least two repetitions on each side; with one,
+// the change is shown but never flagged.  The nodes don't depend on timing,
+// so any increase is flagged, and so is peak memory that grows by more than
+// the threshold.
+//
+// Exits with 0 if nothing got worse, 1 if something did, and 2 if the
+// files can't be compared, as diff does, so scripts can tell them apart.
+#include "solver_lib/bench_results.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Sample {
+    double mean = 0;
+    double variance = 0;    // of the mean, not of a single run
+    std::size_t count = 0;
+};
+
+Sample Summarize(const std::vector<double> &values) {
+    Sample sample;
+    sample.count = values.size();
+    if (values.empty()) return sample;
+    double sum = 0;
+    for (const double v : values) sum += v;
+    sample.mean = sum / static_cast<double>(values.size());
+    if (values.size() < 2) return sample;
+    double squares = 0;
+    for (const double v : values) squares += (v - sample.mean) * (v - sample.mean);
+    const double n = static_cast<double>(values.size());
+    sample.variance = squares / (n - 1) / n;
+    return sample;
+}
+
+// The two-sided 95% quantile of Student's t distribution.  Fractional
+// degrees of freedom round down, which widens the interval a little.
+double StudentT95(double degrees) {
+    static const double table[] = {
+        12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+        2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+        2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+    };
+    const auto whole = static_cast<std::size_t>(std::max(1.0, std::floor(degrees)));
+    if (whole <= std::size(table)) return table[whole - 1];
+    // Close enough beyond 30:  the table's last entry, tending to 1.96.
+    return 1.960 + (2.042 - 1.960) * 30 / static_cast<double>(whole);
+}
+
+// A 95% confidence interval for the difference of the means, as fractions
+// of the baseline's mean.  False if there are too few runs to tell.
+bool Interval(const Sample &base, const Sample &current, double &low, double &high) {
+    if (base.count < 2 || current.count < 2 || base.mean <= 0) return false;
+    const double variance = base.variance + current.variance;
+    double degrees = 1e9;   // no noise at all
+    if (variance > 0) {
+        degrees = variance * variance /
+            (base.variance * base.variance / static_cast<double>(base.count - 1) +
+             current.variance * current.variance /
+                 static_cast<double>(current.count - 1));
+    }
+    const double margin = StudentT95(degrees) * std::sqrt(variance);
+    const double difference = current.mean - base.mean;
+    low = (difference - margin) / base.mean;
+    high = (difference + margin) / base.mean;
+    return true;
+}
+
+// "+5.2%".
+std::string Percent(double fraction) {
+    std::ostringstream out;
+    out << std::showpos << std::fixed << std::setprecision(1) << fraction * 100 << '%';
+    return out.str();
+}
+
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 3) {
+        std::cerr << "Usage: bench_compare BASELINE CURRENT [--threshold PCT]\n";
+        return 2;
+    }
+    double threshold = 0.05;
+    for (int i = 3; i + 1 < argc; i += 2) {
+        if (std::strcmp(argv[i], "--threshold") == 0) {
+            threshold = std::strtod(argv[i + 1], nullptr) / 100;
+        } else {
+            std::cerr << "Unknown option " << argv[i] << '\n';
+            return 2;
+        }
+    }
+
+    BenchResults base;
+    BenchResults current;
+    std::string error;
+    if (!ReadBenchResults(argv[1], base, error)) {
+        std::cerr << argv[1] << ": " << error << '\n';
+        return 2;
+    }
+    if (!ReadBenchResults(argv[2], current, error)) {
+        std::cerr << argv[2] << ": " << error << '\n';
+        return 2;
+    }
+    if (base.suite != current.suite) {
+        std::cerr << "Warning: the suites differ:\n  " << base.suite << "\n  "
+                  << current.suite << '\n';
+    }
+
+    std::map<std::string, const BenchResult *> baseline;
+    for (const auto &result : base.benchmarks) baseline[result.name] = &result;
+    std::size_t width = 9;
+    for (const auto *results : {&base, &current}) {
+        for (const auto &result : results->benchmarks) {
+            width = std::max(width, result.name.size());
+        }
+    }
+
+    std::cout << std::left << std::setw(static_cast<int>(width)) << "benchmark"
+              << std::right << "    base ms     new ms   change  95% interval"
+                 "         verdict\n";
+    std::size_t slower = 0;
+    std::size_t faster = 0;
+    std::size_t worse = 0;      // in nodes or memory
+    std::size_t compared = 0;
+    double log_ratios = 0;
+    for (const auto &result : current.benchmarks) {
+        const auto found = baseline.find(result.name);
+        if (found == baseline.end()) {
+            std::cout << std::left << std::setw(static_cast<int>(width))
+                      << result.name << std::right << "  (not in the baseline)\n";
+            continue;
+        }
+        const BenchResult &before = *found->second;
+        baseline.erase(found);
+        const Sample a = Summarize(before.milliseconds);
+        const Sample b = Summarize(result.milliseconds);
+        if (a.count == 0 || b.count == 0) continue;
+
+        std::string verdict;
+        double low = 0;
+        double high = 0;
+        const double change = a.mean > 0 ? b.mean / a.mean - 1 : 0;
+        std::string interval = "(one run)";
+        if (Interval(a, b, low, high)) {
+            interval = "[" + Percent(low) + ", " + Percent(high) + "]";
+            if (low > 0 && change > threshold) {
+                verdict = "SLOWER";
+                ++slower;
+            } else if (high < 0 && change < -threshold) {
+                verdict = "faster";
+                ++faster;
+            }
+        }
+        if (a.mean > 0 && b.mean > 0) {
+            log_ratios += std::log(b.mean / a.mean);
+            ++compared;
+        }
+        std::vector<std::string> notes;
+        if (result.nodes != before.nodes) {
+            notes.push_back("nodes " + std::to_string(before.nodes) + " -> " +
+                            std::to_string(result.nodes));
+            if (result.nodes > before.nodes) ++worse;
+        }
+        if (static_cast<double>(result.peak_bytes) >
+            static_cast<double>(before.peak_bytes) * (1 + threshold)) {
+            notes.push_back("peak bytes " + std::to_string(before.peak_bytes) +
+                            " -> " + std::to_string(result.peak_bytes));
+            ++worse;
+        }
+
+        std::cout << std::left << std::setw(static_cast<int>(width)) << result.name
+                  << std::right << std::fixed << std::setprecision(3)
+                  << std::setw(11) << a.mean << ' ' << std::setw(10) << b.mean << ' '
+                  << std::setw(8) << Percent(change) << "  "
+                  << std::left << std::setw(20) << interval << std::right;
+        if (!verdict.empty()) std::cout << ' ' << verdict;
+        for (const auto &note : notes) std::cout << "  " << note;
+        std::cout << '\n';
+    }
+    for (const auto &missing : baseline) {
+        std::cout << std::left << std::setw(static_cast<int>(width)) << missing.first
+                  << std::right << "  (missing from the new results)\n";
+    }
+
+    std::cout << '\n' << compared << " compared, " << slower << " slower, "
+              << faster << " faster, " << worse << " worse in nodes or memory";
+    if (compared != 0) {
+        std::cout << "; overall (geometric mean) "
+                  << Percent(std::exp(log_ratios / static_cast<double>(compared)) - 1);
+    }
+    std::cout << '\n';
+    return slower + worse != 0 ? 1 : 0;
+}
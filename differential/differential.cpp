@@ -0,0 +1,610 @@
+// Differential testing:  solves random small puzzles every way solver_lib
+// can and checks that each way finds exactly the solutions that brute force
+// does.
+//
+// Usage: differential [options]
+//   --cases N             number of random puzzles (default 500)
+//   --first-seed S        seed of the first puzzle (default 1)
+//   --slots N             the most slots in a puzzle, up to 20 (default 12)
+//   --mode NAME           check only this mode (default all of them)
+//   --verbose             show each puzzle's number of solutions
+//
+// The puzzles are random mixes of the constraints in constraints.h, small
+// enough to check all 2^slots assignments, which is the reference.  Every
+// mode has to agree with it:  the branching heuristics and value orders,
+// restarts with nogoods, sparse snapshots, partitioned propagation, flat
+// models, SolveParallel, SolvePortfolio, checkpoints, probing the root,
+// cubes and their merged results, the result cache, and solution limits.
+// When a mode disagrees, the puzzle is shrunk, by dropping constraints,
+// indexes, and unused slots for as long as the mode still disagrees, and
+// the smallest one is printed, ready to turn into a test.  Exits with 1
+// if any mode disagreed.
+#include "solver_lib/constraints.h"
+#include "solver_lib/cubes.h"
+#include "solver_lib/probing.h"
+#include "solver_lib/result_cache.h"
+#include "solver_lib/search_tree.h"
+#include "solver_lib/solver.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+// One constraint of constraints.h, as data, so that it can be shrunk and
+// printed.  Identical uses both lists; the others with a list use first.
+struct ConstraintSpec {
+    ConstraintKind kind;
+    Truth value = YES;
+    std::size_t number = 0;
+    IndexList first;
+    IndexList second;
+};
+
+struct Case {
+    std::size_t slots = 0;
+    std::vector<ConstraintSpec> constraints;
+};
+
+// The YES slots of each solution, in order, so that two sets of solutions
+// can be compared whatever order they were found in.
+using SolutionSet = std::vector<IndexList>;
+
+// Distinct random slots.
+IndexList Pick(std::mt19937_64 &rng, std::size_t slots, std::size_t count) {
+    IndexList all(slots);
+    for (Index i = 0; i < slots; ++i) all[i] = i;
+    std::shuffle(all.begin(), all.end(), rng);
+    all.resize(std::min(count, slots));
+    return all;
+}
+
+Case RandomCase(std::uint64_t seed, std::size_t max_slots) {
+    std::mt19937_64 rng(seed);
+    const auto below = [&](std::size_t n) {
+        return static_cast<std::size_t>(rng() % n);
+    };
+    Case c;
+    c.slots = 3 + below(max_slots - 2);
+    const std::size_t count = 1 + below(c.slots);
+    for (std::size_t k = 0; k < count; ++k) {
+        ConstraintSpec spec;
+        spec.value = below(4) == 0 ? NO : YES;
+        // Fixed is rare, since it only removes solutions.
+        const std::size_t kind = below(20);
+        if (kind == 0) {
+            spec.kind = ConstraintKind::FIXED;
+            spec.first = Pick(rng, c.slots, 1);
+        } else if (kind < 5) {
+            spec.kind = ConstraintKind::IF_P_THEN_Q;
+            spec.first = Pick(rng, c.slots, 2);
+        } else if (kind < 7) {
+            spec.kind = ConstraintKind::IDENTICAL;
+            const std::size_t length = 1 + below(2);
+            IndexList both = Pick(rng, c.slots, 2 * length);
+            spec.first.assign(both.begin(), both.begin() + static_cast<std::ptrdiff_t>(length));
+            spec.second.assign(both.begin() + static_cast<std::ptrdiff_t>(length), both.end());
+            spec.first.resize(spec.second.size());
+        } else if (kind < 12) {
+            spec.kind = ConstraintKind::EXACTLY_N_OF;
+            spec.first = Pick(rng, c.slots, 2 + below(4));
+            spec.number = below(spec.first.size() + 1);
+        } else if (kind < 17) {
+            spec.kind = ConstraintKind::AT_MOST_N_OF;
+            spec.first = Pick(rng, c.slots, 2 + below(4));
+            spec.number = below(spec.first.size() + 1);
+        } else {
+            spec.kind = ConstraintKind::IF_P_THEN_ONE_OR_MORE_OF_Q;
+            spec.first = Pick(rng, c.slots, 2 + below(4));
+        }
+        c.constraints.push_back(std::move(spec));
+    }
+    return c;
+}
+
+Puzzle Build(const Case &c) {
+    Puzzle puzzle(c.slots);
+    for (const auto &spec : c.constraints) {
+        IndexList first = spec.first;
+        IndexList second = spec.second;
+        switch (spec.kind) {
+            case ConstraintKind::FIXED:
+                puzzle.Constrain<Fixed>("Fixed", first[0], spec.value);
+                break;
+            case ConstraintKind::IF_P_THEN_Q:
+                puzzle.Constrain<IfPThenQ>("IfPThenQ", first[0], first[1]);
+                break;
+            case ConstraintKind::IDENTICAL:
+                puzzle.Constrain<Identical>("Identical", std::move(first), std::move(second));
+                break;
+            case ConstraintKind::EXACTLY_N_OF:
+                puzzle.Constrain<ExactlyNOf>("ExactlyNOf", spec.number, std::move(first),
+                                             spec.value);
+                break;
+            case ConstraintKind::AT_MOST_N_OF:
+                puzzle.Constrain<AtMostNOf>("AtMostNOf", spec.number, std::move(first),
+                                            spec.value);
+                break;
+            case ConstraintKind::IF_P_THEN_ONE_OR_MORE_OF_Q: {
+                const Index p = first[0];
+                first.erase(first.begin());
+                puzzle.Constrain<IfPThenOneOrMoreOfQ>("IfPThenOneOrMoreOfQ", p,
+                                                      std::move(first));
+                break;
+            }
+        }
+    }
+    return puzzle;
+}
+
+void Print(std::ostream &out, const IndexList &indexes) {
+    out << '{';
+    for (std::size_t i = 0; i < indexes.size(); ++i) {
+        out << (i == 0 ? "" : ", ") << indexes[i];
+    }
+    out << '}';
+}
+
+// As the Constrain calls that build it.
+void Print(std::ostream &out, const Case &c) {
+    out << "Puzzle puzzle(" << c.slots << ");\n";
+    for (const auto &spec : c.constraints) {
+        const char *value = spec.value == YES ? "YES" : "NO";
+        switch (spec.kind) {
+            case ConstraintKind::FIXED:
+                out << "puzzle.Constrain<Fixed>(\"\", " << spec.first[0] << ", "
+                    << value << ");\n";
+                break;
+            case ConstraintKind::IF_P_THEN_Q:
+                out << "puzzle.Constrain<IfPThenQ>(\"\", " << spec.first[0] << ", "
+                    << spec.first[1] << ");\n";
+                break;
+            case ConstraintKind::IDENTICAL:
+                out << "puzzle.Constrain<Identical>(\"\", IndexList";
+                Print(out, spec.first);
+                out << ", IndexList";
+                Print(out, spec.second);
+                out << ");\n";
+                break;
+            case ConstraintKind::EXACTLY_N_OF:
+            case ConstraintKind::AT_MOST_N_OF:
+                out << "puzzle.Constrain<"
+                    << (spec.kind == ConstraintKind::EXACTLY_N_OF ? "ExactlyNOf" : "AtMostNOf")
+                    << ">(\"\", " << spec.number << ", IndexList";
+                Print(out, spec.first);
+                out << ", " << value << ");\n";
+                break;
+            case ConstraintKind::IF_P_THEN_ONE_OR_MORE_OF_Q:
+                out << "puzzle.Constrain<IfPThenOneOrMoreOfQ>(\"\", " << spec.first[0]
+                    << ", IndexList";
+                Print(out, IndexList(spec.first.begin() + 1, spec.first.end()));
+                out << ");\n";
+                break;
+        }
+    }
+}
+
+// In the order they were found.
+SolutionSet YesSlots(const std::vector<Solution> &solutions) {
+    SolutionSet set;
+    for (const auto &s : solutions) {
+        IndexList yes;
+        for (Index i = 0; i < s.size(); ++i) {
+            if (s[i] == YES) yes.push_back(i);
+        }
+        set.push_back(std::move(yes));
+    }
+    return set;
+}
+
+SolutionSet Canonical(const std::vector<Solution> &solutions) {
+    SolutionSet set = YesSlots(solutions);
+    std::sort(set.begin(), set.end());
+    return set;
+}
+
+// Every assignment that no constraint rejects.
+SolutionSet BruteForce(const Puzzle &puzzle) {
+    SolveOptions quiet;
+    quiet.trace = false;
+    SolutionSet set;
+    const std::size_t slots = puzzle.SlotCount();
+    for (std::uint64_t bits = 0; bits < (std::uint64_t{1} << slots); ++bits) {
+        Solution s(slots);
+        IndexList yes;
+        for (Index i = 0; i < slots; ++i) {
+            const bool on = ((bits >> i) & 1) != 0;
+            s.Set(i, on ? YES : NO);
+            if (on) yes.push_back(i);
+        }
+        if (puzzle.Propagate(s, quiet) != Result::CONFLICT) set.push_back(std::move(yes));
+    }
+    std::sort(set.begin(), set.end());
+    return set;
+}
+
+SolveOptions Quiet() {
+    SolveOptions options;
+    options.trace = false;
+    return options;
+}
+
+// A file of its own in the temporary directory.  The random part keeps
+// several runs of the tool apart.
+std::string TemporaryFile(const char *kind, std::uint64_t seed) {
+    const std::string name = "differential-" + std::to_string(std::random_device{}()) +
+                             "-" + std::to_string(seed) + "." + kind;
+    return (std::filesystem::temp_directory_path() / name).string();
+}
+
+// For a mode that found something wrong other than the solutions:  an
+// extra solution makes them disagree with any reference.
+std::vector<Solution> Spoiled(std::vector<Solution> solutions, std::size_t slots) {
+    Solution none(slots);
+    for (Index i = 0; i < slots; ++i) none.Set(i, NO);
+    solutions.push_back(std::move(none));
+    return solutions;
+}
+
+bool Same(const std::vector<Solution> &a, const std::vector<Solution> &b) {
+    return YesSlots(a) == YesSlots(b);
+}
+
+// Each mode solves a puzzle some way.  A mode with a solution limit has
+// to return the first solutions that Solve finds, in the same order.
+struct Mode {
+    const char *name;
+    std::size_t limit;  // zero for all the solutions
+    std::vector<Solution> (*solve)(const Puzzle &puzzle, std::uint64_t seed);
+};
+
+const Mode modes[] = {
+    {"first-maybe", 0, [](const Puzzle &p, std::uint64_t) {
+        return p.Solve(Quiet());
+    }},
+    {"no-first", 0, [](const Puzzle &p, std::uint64_t) {
+        SolveOptions o = Quiet();
+        o.value_order = ValueOrder::NO_FIRST;
+        return p.Solve(o);
+    }},
+    {"fewest-maybes", 0, [](const Puzzle &p, std::uint64_t) {
+        SolveOptions o = Quiet();
+        o.branching = Branching::FEWEST_MAYBES;
+        return p.Solve(o);
+    }},
+    {"random", 0, [](const Puzzle &p, std::uint64_t seed) {
+        SolveOptions o = Quiet();
+        o.branching = Branching::RANDOM;
+        o.value_order = ValueOrder::RANDOM;
+        o.seed = seed;
+        return p.Solve(o);
+    }},
+    {"restarts-nogoods", 0, [](const Puzzle &p, std::uint64_t seed) {
+        SolveOptions o = Quiet();
+        o.branching = Branching::CONFLICT_WEIGHTED;
+        o.value_order = ValueOrder::RANDOM;
+        o.restart_base = 2;
+        o.nogood_length = 6;
+        o.seed = seed;
+        return p.Solve(o);
+    }},
+    {"sparse-snapshots", 0, [](const Puzzle &p, std::uint64_t) {
+        SolveOptions o = Quiet();
+        o.snapshot_interval = 3;
+        return p.Solve(o);
+    }},
+    {"adaptive-snapshots", 0, [](const Puzzle &p, std::uint64_t) {
+        SolveOptions o = Quiet();
+        o.snapshot_interval = 0;
+        return p.Solve(o);
+    }},
+    {"partitioned", 0, [](const Puzzle &p, std::uint64_t) {
+        SolveOptions o = Quiet();
+        o.propagation_threads = 2;
+        return p.Solve(o);
+    }},
+    {"flat-model", 0, [](const Puzzle &p, std::uint64_t) {
+        return Puzzle(p.Flatten()).Solve(Quiet());
+    }},
+    {"parallel", 0, [](const Puzzle &p, std::uint64_t) {
+        SolveOptions o = Quiet();
+        o.split_depth = 2;
+        return p.SolveParallel(o, 2);
+    }},
+    {"portfolio", 0, [](const Puzzle &p, std::uint64_t seed) {
+        SolveOptions o = Quiet();
+        o.seed = seed;
+        o.nogood_length = 6;
+        return p.SolvePortfolio(DefaultPortfolio(4, o));
+    }},
+    {"checkpoint", 0, [](const Puzzle &p, std::uint64_t seed) {
+        // Stop early, then finish from the checkpoint, recording the rest of
+        // the search tree.  The tree has to hold every node examined after
+        // resuming, each after its parent, or the mode fails.
+        SolveOptions o = Quiet();
+        o.checkpoint = TemporaryFile("checkpoint", seed);
+        o.node_limit = 3;
+        SolveStatistics before;
+        p.Solve(o, &before);
+        o.node_limit = 0;
+        o.resume = true;
+        o.search_tree = o.checkpoint + ".tree";
+        SolveStatistics after;
+        auto solutions = p.Solve(o, &after);
+        std::vector<SearchTreeNode> nodes;
+        std::size_t slots = 0;
+        if (!ReadSearchTree(o.search_tree, nodes, slots) ||
+            nodes.size() != after.nodes - before.nodes) {
+            solutions.clear();
+        }
+        std::remove(o.checkpoint.c_str());
+        std::remove(o.search_tree.c_str());
+        return solutions;
+    }},
+    {"probe-root", 0, [](const Puzzle &p, std::uint64_t) {
+        // Every solution agrees with what probing forced.
+        Solution root(p.SlotCount());
+        const ProbeResult probed = ProbeRoot(p, root, 2);
+        if (probed.result == Result::CONFLICT) return std::vector<Solution>{};
+        return p.Solve(probed.forced, Quiet());
+    }},
+    {"cubes", 0, [](const Puzzle &p, std::uint64_t) {
+        // The cubes, through a cube file, have to cover every solution once.
+        // Merging the results of SolveCube has to agree with them too.
+        SplitOptions split;
+        split.cubes = 8;
+        std::stringstream file;
+        WriteCubes(file, p.SlotCount(), SplitIntoCubes(p, split));
+        std::size_t slots = 0;
+        std::vector<Cube> cubes;
+        if (!ReadCubes(file, slots, cubes)) return Spoiled({}, p.SlotCount());
+        std::vector<Solution> solutions;
+        std::stringstream results;
+        WriteResultsHeader(results, p.SlotCount(), cubes.size());
+        for (std::size_t k = 0; k < cubes.size(); ++k) {
+            for (auto &s : p.Solve(cubes[k], Quiet())) solutions.push_back(std::move(s));
+            WriteResult(results, SolveCube(p, cubes[k], k, Quiet()));
+        }
+        std::size_t count = cubes.size();
+        std::vector<CubeResult> read;
+        if (!ReadResults(results, slots, count, read) || read.size() != count) {
+            return Spoiled(std::move(solutions), p.SlotCount());
+        }
+        const MergedResult merged = MergeResults(count, read);
+        const SolutionSet all = Canonical(solutions);
+        const bool agrees =
+            solutions.empty()
+                ? merged.status == CubeStatus::UNSATISFIABLE
+                : merged.status == CubeStatus::SATISFIABLE &&
+                      std::binary_search(all.begin(), all.end(), merged.yes);
+        return agrees ? solutions : Spoiled(std::move(solutions), p.SlotCount());
+    }},
+    {"result-cache", 0, [](const Puzzle &p, std::uint64_t seed) {
+        // Solve, then look the result up in memory, then in the file from a
+        // new cache.  The lookups examine no nodes.
+        const std::string path = TemporaryFile("cache", seed);
+        std::vector<Solution> solutions;
+        bool agrees = false;
+        {
+            ResultCache cache(16, path);
+            solutions = cache.Solve(p, {}, Quiet());
+            SolveStatistics stats;
+            agrees = Same(cache.Solve(p, {}, Quiet(), &stats), solutions) &&
+                     stats.nodes == 0;
+        }
+        {
+            ResultCache cache(16, path);
+            SolveStatistics stats;
+            agrees = agrees && Same(cache.Solve(p, {}, Quiet(), &stats), solutions) &&
+                     stats.nodes == 0;
+        }
+        std::remove(path.c_str());
+        return agrees ? solutions : Spoiled(std::move(solutions), p.SlotCount());
+    }},
+    {"limit-1", 1, [](const Puzzle &p, std::uint64_t) {
+        SolveOptions o = Quiet();
+        o.solution_limit = 1;
+        return p.Solve(o);
+    }},
+    {"parallel-limit-1", 1, [](const Puzzle &p, std::uint64_t) {
+        // Deep enough for solutions between the subtrees.
+        SolveOptions o = Quiet();
+        o.solution_limit = 1;
+        o.split_depth = 3;
+        return p.SolveParallel(o, 2);
+    }},
+    {"parallel-limit-2", 2, [](const Puzzle &p, std::uint64_t) {
+        SolveOptions o = Quiet();
+        o.solution_limit = 2;
+        o.split_depth = 1;
+        return p.SolveParallel(o, 2);
+    }}
+};
+
+// Empty if the mode agrees with the reference, or else what's wrong.
+std::string Disagreement(const Mode &mode, const Puzzle &puzzle,
+                         const SolutionSet &reference, std::uint64_t seed) {
+    const std::vector<Solution> solutions = mode.solve(puzzle, seed);
+    const SolutionSet found = Canonical(solutions);
+    const std::size_t expected =
+        mode.limit == 0 ? reference.size() : std::min(mode.limit, reference.size());
+    if (mode.limit == 0) {
+        if (found == reference) return "";
+    } else if (found.size() == expected) {
+        SolutionSet first = YesSlots(puzzle.Solve(Quiet()));
+        first.resize(expected);
+        if (YesSlots(solutions) == first) return "";
+    }
+    std::string what = std::to_string(found.size()) + " solutions instead of " +
+                       std::to_string(expected);
+    for (const auto &s : found) {
+        if (!std::binary_search(reference.begin(), reference.end(), s)) {
+            return what + ", including one that isn't a solution";
+        }
+    }
+    if (found.size() != expected) return what;
+    return "not the first " + std::to_string(expected) + " solutions that Solve finds";
+}
+
+bool Fails(const Mode &mode, const Case &c, std::uint64_t seed) {
+    const Puzzle puzzle = Build(c);
+    return !Disagreement(mode, puzzle, BruteForce(puzzle), seed).empty();
+}
+
+// The case without slot i, which no constraint mentions.
+Case WithoutSlot(const Case &c, Index i) {
+    Case smaller = c;
+    --smaller.slots;
+    for (auto &spec : smaller.constraints) {
+        for (Index &k : spec.first) k -= k > i ? 1 : 0;
+        for (Index &k : spec.second) k -= k > i ? 1 : 0;
+    }
+    return smaller;
+}
+
+// Drops constraints, indexes from the constraints' lists, and slots that
+// no constraint mentions, for as long as the mode still fails.
+Case Shrink(const Mode &mode, Case c, std::uint64_t seed) {
+    for (bool smaller = true; smaller; ) {
+        smaller = false;
+        std::vector<bool> used(c.slots, false);
+        for (const auto &spec : c.constraints) {
+            for (const Index i : spec.first) used[i] = true;
+            for (const Index i : spec.second) used[i] = true;
+        }
+        for (Index i = c.slots; i-- > 0 && c.slots > 1; ) {
+            if (used[i]) continue;
+            Case attempt = WithoutSlot(c, i);
+            if (Fails(mode, attempt, seed)) {
+                c = std::move(attempt);
+                smaller = true;
+            }
+        }
+        for (std::size_t k = 0; k < c.constraints.size(); ) {
+            Case attempt = c;
+            attempt.constraints.erase(attempt.constraints.begin() +
+                                      static_cast<std::ptrdiff_t>(k));
+            if (Fails(mode, attempt, seed)) {
+                c = std::move(attempt);
+                smaller = true;
+            } else {
+                ++k;
+            }
+        }
+        for (std::size_t k = 0; k < c.constraints.size(); ++k) {
+            const ConstraintSpec &spec = c.constraints[k];
+            const bool lists = spec.kind == ConstraintKind::EXACTLY_N_OF ||
+                               spec.kind == ConstraintKind::AT_MOST_N_OF ||
+                               spec.kind == ConstraintKind::IF_P_THEN_ONE_OR_MORE_OF_Q ||
+                               (spec.kind == ConstraintKind::IDENTICAL &&
+                                spec.first.size() > 1);
+            const std::size_t least =
+                spec.kind == ConstraintKind::IF_P_THEN_ONE_OR_MORE_OF_Q ? 2 : 1;
+            for (std::size_t i = 0; lists && i < c.constraints[k].first.size() &&
+                                    c.constraints[k].first.size() > least; ) {
+                Case attempt = c;
+                ConstraintSpec &s = attempt.constraints[k];
+                s.first.erase(s.first.begin() + static_cast<std::ptrdiff_t>(i));
+                if (s.kind == ConstraintKind::IDENTICAL) {
+                    s.second.erase(s.second.begin() + static_cast<std::ptrdiff_t>(i));
+                }
+                s.number = std::min(s.number, s.first.size());
+                if (Fails(mode, attempt, seed)) {
+                    c = std::move(attempt);
+                    smaller = true;
+                } else {
+                    ++i;
+                }
+            }
+        }
+    }
+
+    return c;
+}
+
+}
+
+int main(int argc, char *argv[]) {
+    std::size_t cases = 500;
+    std::uint64_t first_seed = 1;
+    std::size_t max_slots = 12;
+    const char *only = nullptr;
+    bool verbose = false;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--verbose") == 0) {
+            verbose = true;
+            continue;
+        }
+        if (i + 1 == argc) {
+            std::cerr << "Missing value for " << argv[i] << '\n';
+            return 1;
+        }
+        const char *value = argv[++i];
+        if (std::strcmp(argv[i - 1], "--cases") == 0) {
+            cases = std::strtoull(value, nullptr, 10);
+        } else if (std::strcmp(argv[i - 1], "--first-seed") == 0) {
+            first_seed = std::strtoull(value, nullptr, 10);
+        } else if (std::strcmp(argv[i - 1], "--slots") == 0) {
+            max_slots = std::strtoull(value, nullptr, 10);
+        } else if (std::strcmp(argv[i - 1], "--mode") == 0) {
+            only = value;
+        } else {
+            std::cerr << "Unknown option " << argv[i - 1] << '\n';
+            return 1;
+        }
+    }
+    if (max_slots < 3 || max_slots > 20) {
+        std::cerr << "The number of slots must be from 3 to 20.\n";
+        return 1;
+    }
+    if (only != nullptr &&
+        std::none_of(std::begin(modes), std::end(modes),
+                     [&](const Mode &m) { return std::strcmp(m.name, only) == 0; })) {
+        std::cerr << "Unknown mode " << only << ".  The modes are:\n";
+        for (const auto &mode : modes) std::cerr << "  " << mode.name << '\n';
+        return 1;
+    }
+
+    std::size_t failures = 0;
+    for (std::uint64_t seed = first_seed; seed < first_seed + cases; ++seed) {
+        const Case c = RandomCase(seed, max_slots);
+        const Puzzle puzzle = Build(c);
+        const SolutionSet reference = BruteForce(puzzle);
+        if (verbose) {
+            std::cout << "seed " << seed << ": " << c.slots << " slots, "
+                      << c.constraints.size() << " constraints, "
+                      << reference.size() << " solutions\n";
+        }
+        for (const auto &mode : modes) {
+            if (only != nullptr && std::strcmp(mode.name, only) != 0) continue;
+            const std::string what = Disagreement(mode, puzzle, reference, seed);
+            if (what.empty()) continue;
+            ++failures;
+            // A mode that depends on timing might not fail again, and then
+            // the puzzle stays as it was.
+            const Case smallest = Shrink(mode, c, seed);
+            const Puzzle shrunk = Build(smallest);
+            const std::string still =
+                Disagreement(mode, shrunk, BruteForce(shrunk), seed);
+            std::cout << "Mode " << mode.name << " disagrees on seed " << seed
+                      << ": " << what << ".  "
+                      << (still.empty() ? "It didn't fail again" : "Shrunk to " + still)
+                      << ":\n";
+            Print(std::cout, smallest);
+            std::cout << '\n';
+        }
+    }
+    std::cout << cases << " puzzles, "
+              << (only != nullptr ? 1 : std::size(modes)) << " modes, "
+              << failures << (failures == 1 ? " disagreement\n" : " disagreements\n");
+    return failures == 0 ? 0 : 1;
+}
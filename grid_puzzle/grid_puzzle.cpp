@@ -0,0 +1,139 @@
+// Solves logic grid puzzles described in text files (see
+// solver_lib/description.h and zebra.txt).
+//
+// Usage: grid_puzzle [options] FILE...
+//   --limit N             stop after N solutions, 0 for all (default 2, which
+//                         is enough to tell whether the solution is unique)
+//   --quiet               print only the counts and times, not the solutions
+//   --stats               print the statistics of each search
+//   --cache FILE          remember results in FILE and look them up there
+//                         before solving
+//   --search-tree FILE    record the search tree in FILE, for the search_tree
+//                         tool; takes a single puzzle
+//
+// Each file is read straight into a flat model, so a batch of thousands of
+// puzzles costs no compiling and little more than the solving.
+#include "solver_lib/description.h"
+#include "solver_lib/result_cache.h"
+#include "solver_lib/solver.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+namespace {
+
+double MillisecondsSince(std::chrono::steady_clock::time_point start) {
+    const std::chrono::duration<double, std::milli> elapsed =
+        std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+// One row per category, one column per position.
+void Print(std::ostream &out, const GridDescription &d, const Solution &s) {
+    std::size_t width = 0;
+    for (const auto &name : d.positions) width = std::max(width, name.size());
+    for (const auto &name : d.items) width = std::max(width, name.size());
+    std::size_t label = 0;
+    for (const auto &name : d.categories) label = std::max(label, name.size());
+    const auto w = static_cast<int>(width + 2);
+
+    out << std::setw(static_cast<int>(label)) << "";
+    for (const auto &name : d.positions) out << std::setw(w) << name;
+    out << '\n';
+    const std::size_t positions = d.positions.size();
+    for (std::size_t c = 0; c < d.categories.size(); ++c) {
+        out << std::left << std::setw(static_cast<int>(label))
+            << d.categories[c] << std::right;
+        for (std::size_t p = 0; p < positions; ++p) {
+            std::string item = "?";
+            for (std::size_t i = c * positions; i < (c + 1) * positions; ++i) {
+                if (s[d.IndexOf(p, i)] == YES) item = d.items[i];
+            }
+            out << std::setw(w) << item;
+        }
+        out << '\n';
+    }
+}
+
+}
+
+int main(int argc, char *argv[]) {
+    bool quiet = false;
+    bool statistics = false;
+    SolveOptions options;
+    options.trace = false;
+    options.solution_limit = 2;
+    std::vector<const char *> paths;
+    const char *cache_path = nullptr;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--quiet") == 0) {
+            quiet = true;
+        } else if (std::strcmp(argv[i], "--stats") == 0) {
+            statistics = true;
+            options.time_propagation = true;
+        } else if (std::strcmp(argv[i], "--limit") == 0 && i + 1 < argc) {
+            options.solution_limit = std::strtoull(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--cache") == 0 && i + 1 < argc) {
+            cache_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--search-tree") == 0 && i + 1 < argc) {
+            options.search_tree = argv[++i];
+        } else {
+            paths.push_back(argv[i]);
+        }
+    }
+    if (paths.empty() || (!options.search_tree.empty() && paths.size() > 1)) {
+        std::cerr << "Usage: grid_puzzle [--limit N] [--quiet] [--stats] [--cache FILE] "
+                     "[--search-tree FILE] FILE...\n";
+        return 1;
+    }
+    ResultCache cache(1024, cache_path != nullptr ? cache_path : "");
+    if (cache_path != nullptr && !cache.Persistent()) {
+        std::cerr << "Can't use " << cache_path << " as a cache.\n";
+        return 1;
+    }
+
+    int status = 0;
+    for (const char *path : paths) {
+        std::ifstream in(path);
+        if (!in) {
+            std::cerr << "Can't read " << path << '\n';
+            status = 1;
+            continue;
+        }
+        const auto start = std::chrono::steady_clock::now();
+        GridDescription description;
+        std::string error;
+        if (!ReadDescription(in, description, error)) {
+            std::cerr << path << ": " << error << '\n';
+            status = 1;
+            continue;
+        }
+        const double read_ms = MillisecondsSince(start);
+
+        const auto solve_start = std::chrono::steady_clock::now();
+        const Puzzle puzzle(description.model);
+        SolveStatistics stats;
+        const auto solutions = cache_path != nullptr
+            ? cache.Solve(puzzle, {}, options, &stats)
+            : puzzle.Solve(options, &stats);
+        std::cout << path << ": " << solutions.size()
+                  << (solutions.size() == 1 ? " solution" : " solutions")
+                  << (stats.gave_up ? " (gave up)" : "") << ", "
+                  << puzzle.ConstraintCount() << " constraints, "
+                  << stats.nodes << " nodes, " << std::fixed
+                  << std::setprecision(2) << read_ms << " ms reading, "
+                  << MillisecondsSince(solve_start) << " ms solving\n";
+        if (statistics) std::cout << stats;
+        if (quiet) continue;
+        for (const auto &s : solutions) {
+            Print(std::cout, description, s);
+            std::cout << '\n';
+        }
+    }
+    return status;
+}
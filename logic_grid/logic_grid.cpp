@@ -0,0 +1,253 @@
+#include "logic_grid/logic_grid.h"
+
+#include "solver_lib/constraints.h"
+
+#include <algorithm>
+#include <numeric>
+#include <ostream>
+#include <sstream>
+
+IndexList LogicGrid::Row(Item item) const {
+    IndexList row;
+    for (std::size_t position = 0; position < m_positions; ++position) {
+        row.push_back(IndexOf(position, item));
+    }
+    return row;
+}
+
+IndexList LogicGrid::Col(std::size_t position, std::size_t category) const {
+    IndexList col;
+    for (std::size_t value = 0; value < m_positions; ++value) {
+        col.push_back(IndexOf(position, Item{category, value}));
+    }
+    return col;
+}
+
+IndexList LogicGrid::Neighbors(std::size_t position, Item item) const {
+    IndexList neighbors;
+    if (0 < position) neighbors.push_back(IndexOf(position - 1, item));
+    if (position + 1 < m_positions) {
+        neighbors.push_back(IndexOf(position + 1, item));
+    }
+    return neighbors;
+}
+
+std::string LogicGrid::ItemName(Item item) const {
+    std::stringstream ss;
+    if (item.category < 26) {
+        ss << static_cast<char>('A' + item.category);
+    } else {
+        ss << 'C' << item.category + 1 << ':';
+    }
+    ss << item.value + 1;
+    return ss.str();
+}
+
+std::string LogicGrid::Describe(const Clue &clue) const {
+    std::stringstream ss;
+    switch (clue.type) {
+        case ClueType::SAME:
+            ss << ItemName(clue.a) << " and " << ItemName(clue.b)
+               << " are at the same position.";
+            break;
+        case ClueType::AT:
+            ss << ItemName(clue.a) << " is at position "
+               << clue.position + 1 << '.';
+            break;
+        case ClueType::NOT_AT:
+            ss << ItemName(clue.a) << " is not at position "
+               << clue.position + 1 << '.';
+            break;
+        case ClueType::NEXT_TO:
+            ss << ItemName(clue.a) << " is next to " << ItemName(clue.b) << '.';
+            break;
+        case ClueType::RIGHT_OF:
+            ss << ItemName(clue.a) << " is immediately to the right of "
+               << ItemName(clue.b) << '.';
+            break;
+    }
+    return ss.str();
+}
+
+void LogicGrid::AddBasicRules(Puzzle &puzzle) const {
+    for (std::size_t category = 0; category < m_categories; ++category) {
+        for (std::size_t position = 0; position < m_positions; ++position) {
+            puzzle.Constrain<ExactlyNOf>(
+                "Exactly 1 item of each category at each position.",
+                1, Col(position, category));
+        }
+        for (std::size_t value = 0; value < m_positions; ++value) {
+            puzzle.Constrain<ExactlyNOf>(
+                "Each item is at exactly 1 position.",
+                1, Row(Item{category, value}));
+        }
+    }
+}
+
+void LogicGrid::AddClue(Puzzle &puzzle, const Clue &clue) const {
+    const std::string name = Describe(clue);
+    switch (clue.type) {
+        case ClueType::SAME:
+            puzzle.Constrain<Identical>(name, Row(clue.a), Row(clue.b));
+            break;
+        case ClueType::AT:
+            puzzle.Constrain<Fixed>(name, IndexOf(clue.position, clue.a), YES);
+            break;
+        case ClueType::NOT_AT:
+            puzzle.Constrain<Fixed>(name, IndexOf(clue.position, clue.a), NO);
+            break;
+        case ClueType::NEXT_TO:
+            // Like clue 11 of the Zebra puzzle, but in both directions so
+            // that the solver can reason from either item.
+            for (std::size_t p = 0; p < m_positions; ++p) {
+                puzzle.Constrain<IfPThenOneOrMoreOfQ>(
+                    name, IndexOf(p, clue.a), Neighbors(p, clue.b));
+                puzzle.Constrain<IfPThenOneOrMoreOfQ>(
+                    name, IndexOf(p, clue.b), Neighbors(p, clue.a));
+            }
+            break;
+        case ClueType::RIGHT_OF:
+            // Like clue 6 of the Zebra puzzle, again in both directions.
+            puzzle.Constrain<Fixed>(name, IndexOf(0, clue.a), NO);
+            puzzle.Constrain<Fixed>(name, IndexOf(m_positions - 1, clue.b), NO);
+            for (std::size_t p = 1; p < m_positions; ++p) {
+                puzzle.Constrain<IfPThenQ>(
+                    name, IndexOf(p, clue.a), IndexOf(p - 1, clue.b));
+                puzzle.Constrain<IfPThenQ>(
+                    name, IndexOf(p - 1, clue.b), IndexOf(p, clue.a));
+            }
+            break;
+    }
+}
+
+Puzzle LogicGrid::MakePuzzle(const std::vector<Clue> &clues) const {
+    Puzzle puzzle(SlotCount());
+    AddBasicRules(puzzle);
+    for (const auto &clue : clues) AddClue(puzzle, clue);
+    return puzzle;
+}
+
+Assignment LogicGrid::RandomAssignment(std::mt19937 &rng) const {
+    Assignment answer(m_categories, std::vector<std::size_t>(m_positions));
+    for (auto &positions : answer) {
+        std::iota(positions.begin(), positions.end(), std::size_t{0});
+        std::shuffle(positions.begin(), positions.end(), rng);
+    }
+    return answer;
+}
+
+Clue LogicGrid::RandomClue(const Assignment &answer, std::mt19937 &rng) const {
+    auto const pick = [&rng](std::size_t n) {
+        return std::uniform_int_distribution<std::size_t>(0, n - 1)(rng);
+    };
+    auto const random_item = [&]() {
+        return Item{pick(m_categories), pick(m_positions)};
+    };
+    auto const position_of = [&answer](Item item) {
+        return answer[item.category][item.value];
+    };
+    // Finds the item of the category at the position.
+    auto const item_at = [&](std::size_t category, std::size_t position) {
+        const auto &positions = answer[category];
+        const auto it = std::find(positions.begin(), positions.end(), position);
+        return Item{category, static_cast<std::size_t>(it - positions.begin())};
+    };
+
+    Clue clue{ClueType::AT, random_item(), Item{0, 0}, 0};
+    clue.position = position_of(clue.a);
+    if (m_positions < 2) return clue;
+    const std::size_t other_category =
+        (clue.a.category + 1 + pick(std::max<std::size_t>(m_categories - 1, 1)))
+        % m_categories;
+
+    // The weights favor clues that relate items to each other, which make
+    // for more interesting puzzles than those that give positions away.
+    const std::size_t roll = pick(20);
+    if (roll < 7) {
+        if (m_categories < 2) return clue;
+        clue.type = ClueType::SAME;
+        clue.b = item_at(other_category, clue.position);
+    } else if (roll < 11) {
+        clue.type = ClueType::NEXT_TO;
+        std::size_t neighbor = clue.position + 1;
+        if (neighbor == m_positions || (clue.position > 0 && pick(2) == 0)) {
+            neighbor = clue.position - 1;
+        }
+        clue.b = item_at(other_category, neighbor);
+    } else if (roll < 14) {
+        if (clue.position == 0) return clue;
+        clue.type = ClueType::RIGHT_OF;
+        clue.b = item_at(other_category, clue.position - 1);
+    } else if (roll < 18) {
+        clue.type = ClueType::NOT_AT;
+        clue.position = (clue.position + 1 + pick(m_positions - 1)) % m_positions;
+    }
+    return clue;
+}
+
+Solution LogicGrid::ToSolution(const Assignment &answer) const {
+    Solution s(SlotCount());
+    for (std::size_t category = 0; category < m_categories; ++category) {
+        for (std::size_t value = 0; value < m_positions; ++value) {
+            const Item item{category, value};
+            for (std::size_t position = 0; position < m_positions; ++position) {
+                s.Set(IndexOf(position, item),
+                      position == answer[category][value] ? YES : NO);
+            }
+        }
+    }
+    return s;
+}
+
+void LogicGrid::Print(std::ostream &out, const Solution &s) const {
+    std::string separator = "+";
+    for (std::size_t position = 0; position < m_positions; ++position) {
+        separator += "-----+";
+    }
+    separator += '\n';
+    for (std::size_t category = 0; category < m_categories; ++category) {
+        out << separator;
+        for (std::size_t value = 0; value < m_positions; ++value) {
+            const Item item{category, value};
+            out << '|';
+            for (std::size_t position = 0; position < m_positions; ++position) {
+                switch (s[IndexOf(position, item)]) {
+                    case YES:   out << " YES "; break;
+                    case MAYBE: out << "     "; break;
+                    case NO:    out << " no  "; break;
+                }
+                out << '|';
+            }
+            out << ' ' << ItemName(item) << '\n';
+        }
+    }
+    out << separator;
+}
+
+GeneratedPuzzle GeneratePuzzle(const LogicGrid &grid, std::mt19937 &rng) {
+    GeneratedPuzzle result;
+    result.answer = grid.RandomAssignment(rng);
+
+    // Two solutions are enough to know the answer isn't unique.
+    SolveOptions options;
+    options.trace = false;
+    options.solution_limit = 2;
+    auto const is_unique = [&](const std::vector<Clue> &clues) {
+        ++result.solves;
+        return grid.MakePuzzle(clues).Solve(options).size() == 1;
+    };
+
+    while (!is_unique(result.clues)) {
+        result.clues.push_back(grid.RandomClue(result.answer, rng));
+    }
+
+    // Try to drop each clue, in random order, keeping only the ones without
+    // which the solution would no longer be unique.
+    std::shuffle(result.clues.begin(), result.clues.end(), rng);
+    for (std::size_t i = result.clues.size(); i-- > 0; ) {
+        auto trial = result.clues;
+        trial.erase(trial.begin() + static_cast<std::ptrdiff_t>(i));
+        if (is_unique(trial)) result.clues = std::move(trial);
+    }
+    return result;
+}
@@ -0,0 +1,94 @@
+// Zebra-style logic grids of any size.
+#ifndef LOGIC_GRID_H
+#define LOGIC_GRID_H
+
+#include "solver_lib/solver.h"
+
+#include <cstddef>
+#include <iosfwd>
+#include <random>
+#include <string>
+#include <vector>
+
+// A logic grid has a number of positions (the houses in the Zebra puzzle) and
+// a number of categories (nationality, color, pet, ...).  Each category has
+// one item per position, and each item belongs to exactly one position.
+//
+// The solution layout generalizes the one in zebra.cpp:  for each position,
+// there's one Truth value for every item of every category.
+struct Item {
+    std::size_t category;
+    std::size_t value;
+};
+
+// For each category, the position of each of its items.
+using Assignment = std::vector<std::vector<std::size_t>>;
+
+enum class ClueType {
+    SAME,       // a and b are at the same position
+    AT,         // a is at the given position
+    NOT_AT,     // a is not at the given position
+    NEXT_TO,    // a is immediately to the left or right of b
+    RIGHT_OF    // a is immediately to the right of b
+};
+
+struct Clue {
+    ClueType type;
+    Item a;
+    Item b;
+    std::size_t position;
+};
+
+class LogicGrid {
+    public:
+        LogicGrid(std::size_t positions, std::size_t categories) :
+            m_positions(positions), m_categories(categories) {}
+
+        std::size_t Positions() const { return m_positions; }
+        std::size_t Categories() const { return m_categories; }
+        std::size_t SlotCount() const {
+            return m_positions * m_categories * m_positions;
+        }
+
+        Index IndexOf(std::size_t position, Item item) const {
+            return (position*m_categories + item.category)*m_positions +
+                   item.value;
+        }
+
+        IndexList Row(Item item) const;
+        IndexList Col(std::size_t position, std::size_t category) const;
+        IndexList Neighbors(std::size_t position, Item item) const;
+
+        std::string ItemName(Item item) const;
+        std::string Describe(const Clue &clue) const;
+
+        // Each position has exactly one item of each category, and each item
+        // is at exactly one position.
+        void AddBasicRules(Puzzle &puzzle) const;
+        void AddClue(Puzzle &puzzle, const Clue &clue) const;
+        Puzzle MakePuzzle(const std::vector<Clue> &clues) const;
+
+        Assignment RandomAssignment(std::mt19937 &rng) const;
+        // Proposes a clue that's true for the assignment.
+        Clue RandomClue(const Assignment &answer, std::mt19937 &rng) const;
+        Solution ToSolution(const Assignment &answer) const;
+
+        void Print(std::ostream &out, const Solution &s) const;
+
+    private:
+        std::size_t m_positions;
+        std::size_t m_categories;
+};
+
+struct GeneratedPuzzle {
+    Assignment answer;
+    std::vector<Clue> clues;
+    std::size_t solves = 0;  // number of times the solver was run
+};
+
+// Picks a random hidden assignment and finds a set of clues for which it's
+// the only solution.  Clues are added until the solution is unique, and then
+// every clue that isn't needed to keep it unique is removed.
+GeneratedPuzzle GeneratePuzzle(const LogicGrid &grid, std::mt19937 &rng);
+
+#endif
@@ -0,0 +1,183 @@
+// Measures how solving logic grids scales with the number of positions and
+// categories.
+//
+// Usage: logic_grid_bench [options]
+//   --positions N,...     positions to try (default 5,10,20,30,40,50)
+//   --categories M,...    categories to try (default 5,10,20)
+//   --density D           clues per position per category (default 1.0)
+//   --seeds K             puzzles to solve for each size (default 3)
+//   --limit S             stop after S solutions, 0 for all (default 1)
+//   --node-limit L        give up after L nodes, 0 for none (default 20000)
+//   --repeat R            solve each puzzle R times and report the mean time
+//   --json FILE           also write each puzzle's times and nodes to FILE,
+//                         for bench_compare
+//
+// Unlike the generator, the benchmark doesn't insist on a unique solution.
+// It adds a fixed number of random clues that are true for a random hidden
+// assignment, so every puzzle has at least one solution, and the density
+// controls how much is left for the search to figure out.
+#include "logic_grid/logic_grid.h"
+#include "solver_lib/bench_results.h"
+#include "solver_lib/solver.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::vector<std::size_t> ParseList(const char *text) {
+    std::vector<std::size_t> list;
+    while (*text != '\0') {
+        char *end = nullptr;
+        list.push_back(static_cast<std::size_t>(std::strtoull(text, &end, 10)));
+        if (end == text) break;
+        text = (*end == ',') ? end + 1 : end;
+    }
+    return list;
+}
+
+struct Options {
+    std::vector<std::size_t> positions = {5, 10, 20, 30, 40, 50};
+    std::vector<std::size_t> categories = {5, 10, 20};
+    double density = 1.0;
+    std::size_t seeds = 3;
+    std::size_t repeat = 1;
+    const char *json_path = nullptr;
+    SolveOptions solve;
+};
+
+bool ParseOptions(int argc, char *argv[], Options &options) {
+    options.solve.trace = false;
+    options.solve.solution_limit = 1;
+    options.solve.node_limit = 20000;
+    for (int i = 1; i < argc; ++i) {
+        if (i + 1 == argc) return false;
+        const char *value = argv[i + 1];
+        if (std::strcmp(argv[i], "--positions") == 0) {
+            options.positions = ParseList(value);
+        } else if (std::strcmp(argv[i], "--categories") == 0) {
+            options.categories = ParseList(value);
+        } else if (std::strcmp(argv[i], "--density") == 0) {
+            options.density = std::strtod(value, nullptr);
+        } else if (std::strcmp(argv[i], "--seeds") == 0) {
+            options.seeds = std::strtoull(value, nullptr, 10);
+        } else if (std::strcmp(argv[i], "--limit") == 0) {
+            options.solve.solution_limit = std::strtoull(value, nullptr, 10);
+        } else if (std::strcmp(argv[i], "--node-limit") == 0) {
+            options.solve.node_limit = std::strtoull(value, nullptr, 10);
+        } else if (std::strcmp(argv[i], "--repeat") == 0) {
+            options.repeat = std::max<std::size_t>(1, std::strtoull(value, nullptr, 10));
+        } else if (std::strcmp(argv[i], "--json") == 0) {
+            options.json_path = value;
+        } else {
+            return false;
+        }
+        ++i;
+    }
+    return true;
+}
+
+double MillisecondsSince(std::chrono::steady_clock::time_point start) {
+    const std::chrono::duration<double, std::milli> elapsed =
+        std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+}
+
+int main(int argc, char *argv[]) {
+    Options options;
+    if (!ParseOptions(argc, argv, options)) {
+        std::cerr << "Usage: logic_grid_bench [--positions N,...] "
+                     "[--categories M,...] [--density D] [--seeds K] "
+                     "[--limit S] [--node-limit L] [--repeat R] [--json FILE]\n";
+        return 1;
+    }
+
+    // The suite is the command, less where the results go.
+    BenchResults results;
+    results.suite = "logic_grid_bench";
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--json") == 0) {
+            ++i;
+        } else {
+            results.suite += std::string(" ") + argv[i];
+        }
+    }
+
+    std::cout << "   N    M    slots  constraints  clues   build ms   solve ms"
+                 "      nodes  max nodes  gave up\n";
+    for (const auto categories : options.categories) {
+        for (const auto positions : options.positions) {
+            if (positions < 1 || categories < 1) continue;
+            const LogicGrid grid(positions, categories);
+            const auto clue_count = static_cast<std::size_t>(std::lround(
+                options.density * static_cast<double>(positions * categories)));
+
+            double build_ms = 0.0;
+            double solve_ms = 0.0;
+            std::size_t constraints = 0;
+            std::size_t total_nodes = 0;
+            std::size_t max_nodes = 0;
+            std::size_t gave_up = 0;
+            for (std::size_t seed = 1; seed <= options.seeds; ++seed) {
+                std::mt19937 rng(static_cast<std::mt19937::result_type>(seed));
+                const auto answer = grid.RandomAssignment(rng);
+                std::vector<Clue> clues;
+                for (std::size_t i = 0; i < clue_count; ++i) {
+                    clues.push_back(grid.RandomClue(answer, rng));
+                }
+
+                const auto build_start = std::chrono::steady_clock::now();
+                const Puzzle puzzle = grid.MakePuzzle(clues);
+                build_ms += MillisecondsSince(build_start);
+                constraints = puzzle.ConstraintCount();
+
+                SolveStatistics stats;
+                BenchResult result;
+                result.name = "logic_grid/" + std::to_string(positions) + '/' +
+                              std::to_string(categories) + '/' + std::to_string(seed);
+                for (std::size_t run = 0; run < options.repeat; ++run) {
+                    const auto solve_start = std::chrono::steady_clock::now();
+                    puzzle.Solve(options.solve, &stats);
+                    result.milliseconds.push_back(MillisecondsSince(solve_start));
+                    solve_ms += result.milliseconds.back() /
+                                static_cast<double>(options.repeat);
+                }
+                result.nodes = stats.nodes;
+                result.peak_bytes = stats.allocations.PeakBytes();
+                results.benchmarks.push_back(std::move(result));
+                total_nodes += stats.nodes;
+                max_nodes = std::max(max_nodes, stats.nodes);
+                if (stats.gave_up) ++gave_up;
+            }
+
+            const auto runs = static_cast<double>(std::max<std::size_t>(options.seeds, 1));
+            std::cout << std::fixed << std::setprecision(2)
+                      << std::setw(4) << positions << ' '
+                      << std::setw(4) << categories << ' '
+                      << std::setw(8) << grid.SlotCount() << ' '
+                      << std::setw(12) << constraints << ' '
+                      << std::setw(6) << clue_count << ' '
+                      << std::setw(10) << build_ms / runs << ' '
+                      << std::setw(10) << solve_ms / runs << ' '
+                      << std::setw(10) << static_cast<double>(total_nodes) / runs << ' '
+                      << std::setw(10) << max_nodes << ' '
+                      << std::setw(8) << gave_up << std::endl;
+        }
+    }
+    if (options.json_path != nullptr &&
+        !WriteBenchResults(options.json_path, results)) {
+        std::cerr << "Can't write " << options.json_path << '\n';
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,572 @@
+// Quasigroup completion:  fill in a partial Latin square so that every row
+// and every column contains each symbol exactly once.
+//
+// Usage: quasigroup [options]
+//   --order N             rows (and columns and symbols) in the square (default 15)
+//   --filled F            fraction of cells left filled in (default 0.42)
+//   --seeds K             number of puzzles to solve (default 50)
+//   --first-seed S        seed of the first puzzle (default 1)
+//   --node-limit L        give up after L nodes, 0 for none (default 10000)
+//   --portfolio P         race P differently configured searches on separate
+//                         threads (default 0, a single search)
+//   --nogoods L           learn nogoods of up to L guesses and, in a
+//                         portfolio, share them (default 0, don't learn)
+//   --verbose             show the result for each seed
+//   --progress S          report on each search every S seconds, with an
+//                         estimate of the time left, to stderr
+//   --estimate N          before solving, estimate the size of each
+//                         puzzle's whole search tree from N random probes
+//                         and show it with --verbose
+//   --repeat R            solve each puzzle R times and report the mean time
+//   --json FILE           also write each puzzle's times and nodes to FILE,
+//                         for bench_compare
+//
+// Cube and conquer, for the puzzle with the first seed:
+//   --split FILE          split the puzzle into cubes and write them to FILE
+//   --cubes N             about how many cubes to split into (default 64)
+//   --work FILE           solve the cubes in FILE and write the results
+//   --worker K/W          solve only the cubes numbered K modulo W (default 0/1)
+//   --results FILE        where --work writes the results (default stdout)
+//   --merge FILE          merge the results in FILE (may be repeated)
+//   --save-model FILE     write the compiled puzzle to FILE
+//   --model FILE          load the puzzle from FILE instead of building it,
+//                         for the options above only
+//
+// Workers share nothing but files, so they can run as separate processes on
+// any number of machines, as long as they use the same --order, --filled,
+// and --first-seed (or the same --model).  The node limit applies to each
+// cube.  Loading a saved model maps the file rather than building the
+// constraints one by one, which matters when workers restart often.
+//
+// The puzzles are "quasigroups with holes":  a random Latin square with a
+// random subset of its cells emptied.  That guarantees each puzzle has a
+// solution.  Completion problems are easy when most cells are filled (the
+// constraints force everything) and when few are filled (almost anything
+// works).  The hardest ones are in between, around the phase transition
+// near 42% filled, where the time to solve varies wildly from one instance
+// to the next.  That's why this reports the distribution over many seeds
+// rather than the time for any single puzzle.
+#include "solver_lib/bench_results.h"
+#include "solver_lib/constraints.h"
+#include "solver_lib/cubes.h"
+#include "solver_lib/flat_model.h"
+#include "solver_lib/progress.h"
+#include "solver_lib/solver.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+class LatinSquare {
+    public:
+        explicit LatinSquare(int order) : m_order(order) {}
+
+        int Order() const { return m_order; }
+        std::size_t SlotCount() const {
+            return static_cast<std::size_t>(m_order) * m_order * m_order;
+        }
+
+        Index IndexOf(int row, int col, int sym) const {
+            return static_cast<Index>((row*m_order + col)*m_order + sym);
+        }
+
+        IndexList Cell(int row, int col) const {
+            IndexList result;
+            for (int sym = 0; sym < m_order; ++sym) {
+                result.push_back(IndexOf(row, col, sym));
+            }
+            return result;
+        }
+
+        IndexList Row(int row, int sym) const {
+            IndexList result;
+            for (int col = 0; col < m_order; ++col) {
+                result.push_back(IndexOf(row, col, sym));
+            }
+            return result;
+        }
+
+        IndexList Col(int col, int sym) const {
+            IndexList result;
+            for (int row = 0; row < m_order; ++row) {
+                result.push_back(IndexOf(row, col, sym));
+            }
+            return result;
+        }
+
+        void AddRules(Puzzle &puzzle) const {
+            for (int i = 0; i < m_order; ++i) {
+                for (int j = 0; j < m_order; ++j) {
+                    puzzle.Constrain<ExactlyNOf>("Cell has exactly 1 symbol.", 1, Cell(i, j));
+                    puzzle.Constrain<ExactlyNOf>("Symbol appears exactly once in row.", 1, Row(i, j));
+                    puzzle.Constrain<ExactlyNOf>("Symbol appears exactly once in column.", 1, Col(i, j));
+                }
+            }
+        }
+
+        // A grid lists the symbols row by row, with -1 for an empty cell.
+        using Grid = std::vector<int>;
+
+        void AddGivens(Puzzle &puzzle, const Grid &grid) const {
+            for (int row = 0; row < m_order; ++row) {
+                for (int col = 0; col < m_order; ++col) {
+                    const int sym = grid[static_cast<std::size_t>(row*m_order + col)];
+                    if (sym >= 0) {
+                        puzzle.Constrain<Fixed>("Given", IndexOf(row, col, sym));
+                    }
+                }
+            }
+        }
+
+        // Returns a random Latin square using the Markov chain of Jacobson
+        // and Matthews, which (unlike shuffling the rows, columns, and
+        // symbols of a fixed square) can reach every Latin square of the
+        // order.
+        Grid RandomSquare(std::mt19937 &rng) const {
+            const int n = m_order;
+            // The incidence cube has a 1 at (row, col, sym) when the cell at
+            // (row, col) holds sym.  While the square is "improper," exactly
+            // one entry is -1.
+            std::vector<std::int8_t> cube(SlotCount(), 0);
+            auto const at = [&](int r, int c, int s) -> std::int8_t & {
+                return cube[IndexOf(r, c, s)];
+            };
+            for (int r = 0; r < n; ++r) {
+                for (int c = 0; c < n; ++c) at(r, c, (r + c) % n) = 1;
+            }
+
+            std::uniform_int_distribution<int> pick(0, n - 1);
+            std::bernoulli_distribution coin;
+            // Finds the coordinate along one axis where the line through the
+            // other two has a 1.  When improper, there are two and we pick one
+            // at random.
+            auto const find_one = [&](bool improper, auto &&value_at) {
+                int found = -1;
+                for (int i = 0; i < n; ++i) {
+                    if (value_at(i) == 1) {
+                        if (found < 0 || coin(rng)) found = i;
+                        if (!improper) break;
+                    }
+                }
+                return found;
+            };
+
+            bool proper = true;
+            int r = 0, c = 0, s = 0;
+            // With only one symbol, there's nothing to shuffle.
+            const long long steps = n < 2 ? 0 : static_cast<long long>(n) * n * n;
+            for (long long step = 0; step < steps || !proper; ++step) {
+                if (proper) {
+                    do {
+                        r = pick(rng); c = pick(rng); s = pick(rng);
+                    } while (at(r, c, s) != 0);
+                }
+                const int r2 = find_one(!proper, [&](int i) { return at(i, c, s); });
+                const int c2 = find_one(!proper, [&](int i) { return at(r, i, s); });
+                const int s2 = find_one(!proper, [&](int i) { return at(r, c, i); });
+                ++at(r, c, s);  ++at(r, c2, s2); ++at(r2, c, s2); ++at(r2, c2, s);
+                --at(r, c, s2); --at(r, c2, s);  --at(r2, c, s);  --at(r2, c2, s2);
+                proper = at(r2, c2, s2) != -1;
+                if (!proper) { r = r2; c = c2; s = s2; }
+            }
+
+            Grid grid;
+            for (int row = 0; row < n; ++row) {
+                for (int col = 0; col < n; ++col) {
+                    for (int sym = 0; sym < n; ++sym) {
+                        if (at(row, col, sym) == 1) grid.push_back(sym);
+                    }
+                }
+            }
+            return grid;
+        }
+
+        void Print(std::ostream &out, const Grid &grid) const {
+            const int width = m_order < 10 ? 2 : 3;
+            for (int row = 0; row < m_order; ++row) {
+                for (int col = 0; col < m_order; ++col) {
+                    const int sym = grid[static_cast<std::size_t>(row*m_order + col)];
+                    if (sym < 0) {
+                        out << std::setw(width) << '.';
+                    } else {
+                        out << std::setw(width) << sym;
+                    }
+                }
+                out << '\n';
+            }
+        }
+
+        Grid ToGrid(const IndexList &yes) const {
+            const auto n = static_cast<std::size_t>(m_order);
+            Grid grid(n * n, -1);
+            for (const Index i : yes) grid[i / n] = static_cast<int>(i % n);
+            return grid;
+        }
+
+    private:
+        int m_order;
+};
+
+// Returns a random Latin square with each cell kept with the probability
+// filled and otherwise emptied.
+LatinSquare::Grid RandomHoles(const LatinSquare &square, double filled,
+                              std::size_t seed, std::size_t *givens) {
+    std::mt19937 rng(static_cast<std::mt19937::result_type>(seed));
+    auto grid = square.RandomSquare(rng);
+    std::bernoulli_distribution keep(filled);
+    *givens = 0;
+    for (auto &sym : grid) {
+        if (keep(rng)) ++*givens; else sym = -1;
+    }
+    return grid;
+}
+
+double MillisecondsSince(std::chrono::steady_clock::time_point start) {
+    const std::chrono::duration<double, std::milli> elapsed =
+        std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+int SplitCommand(const LatinSquare &square, const Puzzle &puzzle,
+                 const SplitOptions &split, const char *path) {
+    const auto start = std::chrono::steady_clock::now();
+    const auto cubes = SplitIntoCubes(puzzle, split);
+    std::ofstream out(path);
+    WriteCubes(out, square.SlotCount(), cubes);
+    if (!out) {
+        std::cerr << "Can't write " << path << '\n';
+        return 1;
+    }
+    std::cout << "Wrote " << cubes.size() << " cubes to " << path << " in "
+              << std::fixed << std::setprecision(2) << MillisecondsSince(start)
+              << " ms\n";
+    return 0;
+}
+
+int WorkCommand(const LatinSquare &square, const Puzzle &puzzle,
+                const SolveOptions &options, const char *path,
+                const char *worker, const char *results_path) {
+    std::ifstream in(path);
+    std::size_t slots = 0;
+    std::vector<Cube> cubes;
+    if (!ReadCubes(in, slots, cubes) || slots != square.SlotCount()) {
+        std::cerr << path << " isn't a cube file for this puzzle.\n";
+        return 1;
+    }
+    char *end = nullptr;
+    const std::size_t k = std::strtoull(worker, &end, 10);
+    const std::size_t w = *end == '/' ? std::strtoull(end + 1, nullptr, 10) : 1;
+    if (w == 0 || k >= w) {
+        std::cerr << "Bad --worker " << worker << '\n';
+        return 1;
+    }
+
+    std::ofstream file;
+    if (results_path != nullptr) file.open(results_path);
+    std::ostream &out = results_path != nullptr ? file : std::cout;
+    WriteResultsHeader(out, slots, cubes.size());
+    for (std::size_t i = k; i < cubes.size(); i += w) {
+        WriteResult(out, SolveCube(puzzle, cubes[i], i, options));
+    }
+    return out ? 0 : 1;
+}
+
+int MergeCommand(const LatinSquare &square,
+                 const std::vector<const char *> &paths) {
+    std::size_t slots = 0, cubes = 0;
+    std::vector<CubeResult> results;
+    for (const char *path : paths) {
+        std::ifstream in(path);
+        if (!ReadResults(in, slots, cubes, results)) {
+            std::cerr << path << " isn't a results file for the same cubes.\n";
+            return 1;
+        }
+    }
+    if (slots != square.SlotCount()) {
+        std::cerr << "The results aren't for this puzzle.\n";
+        return 1;
+    }
+    const MergedResult merged = MergeResults(cubes, results);
+    std::cout << merged.solved << " of " << cubes << " cubes solved, "
+              << merged.nodes << " nodes\n";
+    switch (merged.status) {
+        case CubeStatus::SATISFIABLE:
+            std::cout << "Solution:\n";
+            square.Print(std::cout, square.ToGrid(merged.yes));
+            break;
+        case CubeStatus::UNSATISFIABLE:
+            std::cout << "No solution.\n";
+            break;
+        case CubeStatus::UNKNOWN:
+            std::cout << "Unknown, " << merged.missing << " cubes unsolved.\n";
+            break;
+    }
+    return 0;
+}
+
+template <typename T>
+T Percentile(std::vector<T> sorted, double p) {
+    std::sort(sorted.begin(), sorted.end());
+    const auto rank = static_cast<std::size_t>(
+        std::ceil(p * static_cast<double>(sorted.size())));
+    return sorted[std::clamp<std::size_t>(rank, 1, sorted.size()) - 1];
+}
+
+}
+
+int main(int argc, char *argv[]) {
+    int order = 15;
+    double filled = 0.42;
+    std::size_t seeds = 50;
+    std::size_t first_seed = 1;
+    std::size_t portfolio = 0;
+    std::size_t probes = 0;
+    std::size_t repeat = 1;
+    const char *json_path = nullptr;
+    bool verbose = false;
+    const char *split_path = nullptr;
+    const char *work_path = nullptr;
+    const char *worker = "0/1";
+    const char *results_path = nullptr;
+    std::vector<const char *> merge_paths;
+    const char *save_path = nullptr;
+    const char *model_path = nullptr;
+    SplitOptions split;
+    SolveOptions options;
+    ProgressPrinter progress(std::cerr);
+    options.trace = false;
+    options.solution_limit = 1;
+    options.node_limit = 10000;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--verbose") == 0) {
+            verbose = true;
+            continue;
+        }
+        if (i + 1 == argc) {
+            std::cerr << "Missing value for " << argv[i] << '\n';
+            return 1;
+        }
+        const char *value = argv[++i];
+        if (std::strcmp(argv[i - 1], "--order") == 0) {
+            order = std::atoi(value);
+        } else if (std::strcmp(argv[i - 1], "--filled") == 0) {
+            filled = std::strtod(value, nullptr);
+        } else if (std::strcmp(argv[i - 1], "--seeds") == 0) {
+            seeds = std::strtoull(value, nullptr, 10);
+        } else if (std::strcmp(argv[i - 1], "--first-seed") == 0) {
+            first_seed = std::strtoull(value, nullptr, 10);
+        } else if (std::strcmp(argv[i - 1], "--node-limit") == 0) {
+            options.node_limit = std::strtoull(value, nullptr, 10);
+        } else if (std::strcmp(argv[i - 1], "--portfolio") == 0) {
+            portfolio = std::strtoull(value, nullptr, 10);
+        } else if (std::strcmp(argv[i - 1], "--nogoods") == 0) {
+            options.nogood_length = std::strtoull(value, nullptr, 10);
+        } else if (std::strcmp(argv[i - 1], "--progress") == 0) {
+            options.progress = &progress;
+            options.progress_interval = std::strtod(value, nullptr);
+        } else if (std::strcmp(argv[i - 1], "--estimate") == 0) {
+            probes = std::strtoull(value, nullptr, 10);
+        } else if (std::strcmp(argv[i - 1], "--repeat") == 0) {
+            repeat = std::max<std::size_t>(1, std::strtoull(value, nullptr, 10));
+        } else if (std::strcmp(argv[i - 1], "--json") == 0) {
+            json_path = value;
+        } else if (std::strcmp(argv[i - 1], "--split") == 0) {
+            split_path = value;
+        } else if (std::strcmp(argv[i - 1], "--cubes") == 0) {
+            split.cubes = std::strtoull(value, nullptr, 10);
+        } else if (std::strcmp(argv[i - 1], "--work") == 0) {
+            work_path = value;
+        } else if (std::strcmp(argv[i - 1], "--worker") == 0) {
+            worker = value;
+        } else if (std::strcmp(argv[i - 1], "--results") == 0) {
+            results_path = value;
+        } else if (std::strcmp(argv[i - 1], "--merge") == 0) {
+            merge_paths.push_back(value);
+        } else if (std::strcmp(argv[i - 1], "--save-model") == 0) {
+            save_path = value;
+        } else if (std::strcmp(argv[i - 1], "--model") == 0) {
+            model_path = value;
+        } else {
+            std::cerr << "Unknown option " << argv[i - 1] << '\n';
+            return 1;
+        }
+    }
+    if (order < 1 || seeds < 1) {
+        std::cerr << "The order and the number of seeds must be positive.\n";
+        return 1;
+    }
+    // A model is one puzzle, and the benchmark needs one for each seed.
+    const bool cubes = split_path != nullptr || work_path != nullptr ||
+                       !merge_paths.empty() || save_path != nullptr;
+    if (model_path != nullptr && !cubes) {
+        std::cerr << "--model only works with --split, --work, --merge, or "
+                     "--save-model.\n";
+        return 1;
+    }
+
+    const LatinSquare square(order);
+    if (cubes) {
+        const auto start = std::chrono::steady_clock::now();
+        std::shared_ptr<const FlatModel> model;
+        if (model_path != nullptr) {
+            model = FlatModel::Open(model_path);
+            if (!model || model->SlotCount() != square.SlotCount()) {
+                std::cerr << model_path << " isn't a model of this order.\n";
+                return 1;
+            }
+        }
+        Puzzle puzzle = model ? Puzzle(model) : Puzzle(square.SlotCount());
+        if (!model) {
+            std::size_t givens = 0;
+            const auto grid = RandomHoles(square, filled, first_seed, &givens);
+            square.AddRules(puzzle);
+            square.AddGivens(puzzle, grid);
+        }
+        if (verbose) {
+            std::cerr << (model ? "Loaded " : "Built ")
+                      << puzzle.ConstraintCount() << " constraints in "
+                      << std::fixed << std::setprecision(2)
+                      << MillisecondsSince(start) << " ms\n";
+        }
+        if (save_path != nullptr) {
+            if (!puzzle.Save(save_path)) {
+                std::cerr << "Can't write " << save_path << '\n';
+                return 1;
+            }
+            std::cout << "Wrote " << puzzle.ConstraintCount()
+                      << " constraints to " << save_path << '\n';
+            return 0;
+        }
+        if (split_path != nullptr) {
+            return SplitCommand(square, puzzle, split, split_path);
+        }
+        if (work_path != nullptr) {
+            return WorkCommand(square, puzzle, options, work_path, worker,
+                               results_path);
+        }
+        return MergeCommand(square, merge_paths);
+    }
+    std::vector<double> times;
+    std::vector<std::size_t> nodes;
+    std::size_t gave_up = 0;
+    std::vector<std::size_t> wins(portfolio + 1, 0);
+    BenchResults results;
+    results.suite = "quasigroup";
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--json") == 0) {
+            ++i;
+        } else {
+            results.suite += std::string(" ") + argv[i];
+        }
+    }
+    if (verbose) {
+        std::cout << "    seed  givens   solve ms      nodes"
+                  << (probes != 0 ? "    estimate" : "") << '\n';
+    }
+    for (std::size_t seed = first_seed; seed < first_seed + seeds; ++seed) {
+        std::size_t givens = 0;
+        const auto grid = RandomHoles(square, filled, seed, &givens);
+        Puzzle puzzle(square.SlotCount());
+        square.AddRules(puzzle);
+        square.AddGivens(puzzle, grid);
+
+        // The estimate is for finding every solution, so it's an upper
+        // bound of sorts when the search stops at the first.
+        double estimate = 0;
+        if (probes != 0) estimate = puzzle.EstimateNodes(options, probes);
+
+        SolveStatistics stats;
+        BenchResult result;
+        result.name = "quasigroup/" + std::to_string(seed);
+        double mean_ms = 0.0;
+        for (std::size_t run = 0; run < repeat; ++run) {
+            const auto start = std::chrono::steady_clock::now();
+            if (portfolio == 0) {
+                puzzle.Solve(options, &stats);
+            } else {
+                std::size_t winner = portfolio;
+                puzzle.SolvePortfolio(DefaultPortfolio(portfolio, options),
+                                      &stats, &winner);
+                ++wins[winner];
+            }
+            result.milliseconds.push_back(MillisecondsSince(start));
+            mean_ms += result.milliseconds.back() / static_cast<double>(repeat);
+        }
+        result.nodes = stats.nodes;
+        result.peak_bytes = stats.allocations.PeakBytes();
+        results.benchmarks.push_back(std::move(result));
+        times.push_back(mean_ms);
+        nodes.push_back(stats.nodes);
+        if (stats.gave_up) ++gave_up;
+        if (verbose) {
+            std::cout << std::fixed << std::setprecision(2)
+                      << std::setw(8) << seed << ' ' << std::setw(7) << givens
+                      << ' ' << std::setw(10) << times.back() << ' '
+                      << std::setw(10) << nodes.back();
+            if (probes != 0) {
+                std::cout << ' ' << std::setprecision(0) << std::setw(11) << estimate;
+            }
+            std::cout << (stats.gave_up ? " (gave up)" : "") << '\n';
+        }
+    }
+
+    double total_ms = 0.0;
+    for (double t : times) total_ms += t;
+    std::cout << "order " << order << ", " << filled * 100.0 << "% filled, "
+              << seeds << " seeds, " << gave_up << " gave up\n\n";
+    std::cout << std::fixed << std::setprecision(2)
+              << "              ms      nodes\n"
+              << "min   " << std::setw(10) << Percentile(times, 0.0) << ' '
+              << std::setw(10) << Percentile(nodes, 0.0) << '\n'
+              << "p50   " << std::setw(10) << Percentile(times, 0.50) << ' '
+              << std::setw(10) << Percentile(nodes, 0.50) << '\n'
+              << "p90   " << std::setw(10) << Percentile(times, 0.90) << ' '
+              << std::setw(10) << Percentile(nodes, 0.90) << '\n'
+              << "p99   " << std::setw(10) << Percentile(times, 0.99) << ' '
+              << std::setw(10) << Percentile(nodes, 0.99) << '\n'
+              << "max   " << std::setw(10) << Percentile(times, 1.0) << ' '
+              << std::setw(10) << Percentile(nodes, 1.0) << '\n'
+              << "mean  " << std::setw(10) << total_ms / static_cast<double>(seeds)
+              << "\n\n";
+
+    if (portfolio != 0) {
+        std::cout << "configuration  wins\n";
+        for (std::size_t i = 0; i < portfolio; ++i) {
+            std::cout << std::setw(13) << i << ' ' << std::setw(5) << wins[i] << '\n';
+        }
+        std::cout << '\n';
+    }
+
+    // A histogram of node counts in powers of two shows the shape of the
+    // tail, which the percentiles alone can hide.
+    std::vector<std::size_t> buckets;
+    for (const auto count : nodes) {
+        std::size_t bucket = 0;
+        while ((std::size_t{2} << bucket) <= count) ++bucket;
+        if (buckets.size() <= bucket) buckets.resize(bucket + 1, 0);
+        ++buckets[bucket];
+    }
+    std::cout << "nodes              runs\n";
+    for (std::size_t b = 0; b < buckets.size(); ++b) {
+        std::cout << std::setw(8) << (std::size_t{1} << b) << " - "
+                  << std::setw(8) << (std::size_t{2} << b) - 1 << ' '
+                  << std::setw(4) << buckets[b] << ' '
+                  << std::string(buckets[b], '*') << '\n';
+    }
+    if (json_path != nullptr && !WriteBenchResults(json_path, results)) {
+        std::cerr << "Can't write " << json_path << '\n';
+        return 1;
+    }
+    return 0;
+}
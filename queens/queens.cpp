@@ -0,0 +1,280 @@
+// The N-Queens puzzle:  place N queens on an N x N chessboard so that no two
+// share a row, a column, or a diagonal.
+//
+// Usage: queens [options]
+//   --count-max N         count all solutions for boards up to N (default 10)
+//   --sizes N,...         boards to find a first solution for, up to 1000
+//                         (default 8,12,16,20,24,28)
+//   --node-limit L        give up after L nodes, 0 for none (default 0)
+//   --portfolio P         race P differently configured searches for the
+//                         first solutions (default 0, a single search)
+//   --threads T           count solutions with SolveParallel on T threads
+//                         (default 0, a single search); the counts and
+//                         nodes are the same for any T
+//   --snapshot-interval K copy the board only every K levels of the search
+//                         and replay guesses in between, 0 to adapt
+//                         (default 1, copy every level)
+//   --checkpoint PREFIX   while counting, save progress to PREFIX.N every
+//                         100000 nodes and resume from it when run again
+//   --show N              print a solution for an N x N board and exit
+//   --repeat R            run each search R times and report the mean time;
+//                         not with --checkpoint, which would resume the
+//                         finished counts
+//   --json FILE           also write each search's times and nodes to FILE,
+//                         for bench_compare
+//
+// Every row and every column has exactly one queen, but a diagonal may have
+// none, so the diagonals use AtMostNOf.  The diagonals of a big board are long
+// and there are many of them, and finding a first solution takes a deep
+// search, which stresses the solver differently than Sudoku does.  By
+// default, the solver keeps a copy of the board for every level of the
+// search, so a deep search on a 1000 x 1000 board needs gigabytes; use
+// --snapshot-interval 0 to trade some propagation for most of that memory.
+// The default search guesses at the first empty square, which finds a first
+// solution quickly only up to about 28; the randomized configurations of
+// --portfolio reach 256 in about a minute on one core.
+#include "solver_lib/bench_results.h"
+#include "solver_lib/constraints.h"
+#include "solver_lib/solver.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace {
+
+class Queens {
+    public:
+        explicit Queens(std::size_t n) : m_n(n) {}
+
+        std::size_t SlotCount() const { return m_n * m_n; }
+
+        Index IndexOf(std::size_t row, std::size_t col) const {
+            return row*m_n + col;
+        }
+
+        void AddRules(Puzzle &puzzle) const {
+            for (std::size_t i = 0; i < m_n; ++i) {
+                IndexList row, col;
+                for (std::size_t j = 0; j < m_n; ++j) {
+                    row.push_back(IndexOf(i, j));
+                    col.push_back(IndexOf(j, i));
+                }
+                puzzle.Constrain<ExactlyNOf>("One queen in each row.", 1, std::move(row));
+                puzzle.Constrain<ExactlyNOf>("One queen in each column.", 1, std::move(col));
+            }
+            // Diagonals are numbered by row + col (descending to the left)
+            // and by row - col + n - 1 (descending to the right).  Those of
+            // length 1, in the corners, can't be violated.
+            for (std::size_t d = 1; d + 2 < 2*m_n; ++d) {
+                IndexList down_left, down_right;
+                for (std::size_t row = 0; row < m_n; ++row) {
+                    if (d >= row && d - row < m_n) {
+                        down_left.push_back(IndexOf(row, d - row));
+                    }
+                    if (row + m_n - 1 >= d && row + m_n - 1 - d < m_n) {
+                        down_right.push_back(IndexOf(row, row + m_n - 1 - d));
+                    }
+                }
+                puzzle.Constrain<AtMostNOf>("At most one queen on each diagonal.", 1, std::move(down_left));
+                puzzle.Constrain<AtMostNOf>("At most one queen on each diagonal.", 1, std::move(down_right));
+            }
+        }
+
+        void Print(std::ostream &out, const Solution &s) const {
+            for (std::size_t row = 0; row < m_n; ++row) {
+                for (std::size_t col = 0; col < m_n; ++col) {
+                    out << (s[IndexOf(row, col)] == YES ? " Q" : " .");
+                }
+                out << '\n';
+            }
+        }
+
+    private:
+        std::size_t m_n;
+};
+
+double MillisecondsSince(std::chrono::steady_clock::time_point start) {
+    const std::chrono::duration<double, std::milli> elapsed =
+        std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+// The number of solutions for boards of size 1 through 15.
+constexpr std::size_t known_counts[] = {
+    1, 0, 0, 2, 10, 4, 40, 92, 352, 724, 2680, 14200, 73712, 365596, 2279184
+};
+
+}
+
+int main(int argc, char *argv[]) {
+    std::size_t count_max = 10;
+    std::vector<std::size_t> sizes = {8, 12, 16, 20, 24, 28};
+    std::size_t portfolio = 0;
+    std::size_t threads = 0;
+    std::string checkpoint;
+    std::size_t repeat = 1;
+    const char *json_path = nullptr;
+    SolveOptions options;
+    options.trace = false;
+    for (int i = 1; i < argc; i += 2) {
+        if (i + 1 == argc) {
+            std::cerr << "Missing value for " << argv[i] << '\n';
+            return 1;
+        }
+        const char *value = argv[i + 1];
+        if (std::strcmp(argv[i], "--count-max") == 0) {
+            count_max = std::strtoull(value, nullptr, 10);
+        } else if (std::strcmp(argv[i], "--sizes") == 0) {
+            sizes.clear();
+            for (const char *p = value; *p != '\0'; ) {
+                char *end = nullptr;
+                sizes.push_back(std::strtoull(p, &end, 10));
+                if (end == p) break;
+                p = (*end == ',') ? end + 1 : end;
+            }
+        } else if (std::strcmp(argv[i], "--node-limit") == 0) {
+            options.node_limit = std::strtoull(value, nullptr, 10);
+        } else if (std::strcmp(argv[i], "--portfolio") == 0) {
+            portfolio = std::strtoull(value, nullptr, 10);
+        } else if (std::strcmp(argv[i], "--snapshot-interval") == 0) {
+            options.snapshot_interval = std::strtoull(value, nullptr, 10);
+        } else if (std::strcmp(argv[i], "--checkpoint") == 0) {
+            checkpoint = value;
+        } else if (std::strcmp(argv[i], "--threads") == 0) {
+            threads = std::strtoull(value, nullptr, 10);
+        } else if (std::strcmp(argv[i], "--repeat") == 0) {
+            repeat = std::max<std::size_t>(1, std::strtoull(value, nullptr, 10));
+        } else if (std::strcmp(argv[i], "--json") == 0) {
+            json_path = value;
+        } else if (std::strcmp(argv[i], "--show") == 0) {
+            const Queens queens(std::strtoull(value, nullptr, 10));
+            Puzzle puzzle(queens.SlotCount());
+            queens.AddRules(puzzle);
+            options.solution_limit = 1;
+            for (const auto &s : puzzle.Solve(options)) queens.Print(std::cout, s);
+            return 0;
+        } else {
+            std::cerr << "Unknown option " << argv[i] << '\n';
+            return 1;
+        }
+    }
+
+    if (repeat > 1 && !checkpoint.empty()) {
+        std::cerr << "--repeat doesn't work with --checkpoint.\n";
+        return 1;
+    }
+
+    // The suite is the command, less where the results go.
+    BenchResults results;
+    results.suite = "queens";
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--json") == 0) {
+            ++i;
+        } else {
+            results.suite += std::string(" ") + argv[i];
+        }
+    }
+
+    std::cout << "All solutions\n"
+                 "   N  solutions   expected   solve ms      nodes\n";
+    for (std::size_t n = 1; n <= count_max; ++n) {
+        const Queens queens(n);
+        Puzzle puzzle(queens.SlotCount());
+        queens.AddRules(puzzle);
+        SolveOptions all = options;
+        all.node_limit = 0;
+        if (!checkpoint.empty()) {
+            all.checkpoint = checkpoint + '.' + std::to_string(n);
+            all.checkpoint_interval = 100000;
+            all.resume = true;
+        }
+        SolveStatistics stats;
+        BenchResult result;
+        result.name = "queens/count/" + std::to_string(n);
+        double ms = 0.0;
+        for (std::size_t run = 0; run < repeat; ++run) {
+            const auto start = std::chrono::steady_clock::now();
+            if (threads == 0) {
+                puzzle.Solve(all, &stats);
+            } else {
+                puzzle.SolveParallel(all, threads, &stats);
+            }
+            result.milliseconds.push_back(MillisecondsSince(start));
+            ms += result.milliseconds.back() / static_cast<double>(repeat);
+        }
+        result.nodes = stats.nodes;
+        result.peak_bytes = stats.allocations.PeakBytes();
+        results.benchmarks.push_back(std::move(result));
+        std::cout << std::setw(4) << n << ' ' << std::setw(10) << stats.solutions
+                  << ' ' << std::setw(10);
+        if (n <= std::size(known_counts)) {
+            std::cout << known_counts[n - 1];
+        } else {
+            std::cout << '?';
+        }
+        std::cout << ' ' << std::fixed << std::setprecision(2)
+                  << std::setw(10) << ms << ' ' << std::setw(10) << stats.nodes;
+        if (n <= std::size(known_counts) && stats.solutions != known_counts[n - 1]) {
+            std::cout << "  WRONG";
+        }
+        if (stats.checkpoint_failures != 0) {
+            std::cout << "  (couldn't write " << all.checkpoint << ')';
+        }
+        std::cout << std::endl;
+    }
+
+    std::cout << "\nFirst solution\n"
+                 "   N      slots  constraints   build ms   solve ms      nodes  guesses\n";
+    std::size_t winner = 0;
+    for (const auto n : sizes) {
+        if (n < 1) continue;
+        const Queens queens(n);
+        const auto build_start = std::chrono::steady_clock::now();
+        Puzzle puzzle(queens.SlotCount());
+        queens.AddRules(puzzle);
+        const double build_ms = MillisecondsSince(build_start);
+
+        SolveOptions first = options;
+        first.solution_limit = 1;
+        SolveStatistics stats;
+        BenchResult result;
+        result.name = "queens/first/" + std::to_string(n);
+        double ms = 0.0;
+        for (std::size_t run = 0; run < repeat; ++run) {
+            const auto start = std::chrono::steady_clock::now();
+            if (portfolio == 0) {
+                puzzle.Solve(first, &stats);
+            } else {
+                puzzle.SolvePortfolio(DefaultPortfolio(portfolio, first),
+                                      &stats, &winner);
+            }
+            result.milliseconds.push_back(MillisecondsSince(start));
+            ms += result.milliseconds.back() / static_cast<double>(repeat);
+        }
+        result.nodes = stats.nodes;
+        result.peak_bytes = stats.allocations.PeakBytes();
+        results.benchmarks.push_back(std::move(result));
+        std::cout << std::fixed << std::setprecision(2)
+                  << std::setw(4) << n << ' ' << std::setw(10) << queens.SlotCount()
+                  << ' ' << std::setw(12) << puzzle.ConstraintCount() << ' '
+                  << std::setw(10) << build_ms << ' ' << std::setw(10) << ms << ' '
+                  << std::setw(10) << stats.nodes << ' ' << std::setw(8) << stats.guesses
+                  << (stats.gave_up ? "  gave up" : "");
+        if (portfolio != 0 && !stats.gave_up) {
+            std::cout << "  (configuration " << winner << ')';
+        }
+        std::cout << std::endl;
+    }
+    if (json_path != nullptr && !WriteBenchResults(json_path, results)) {
+        std::cerr << "Can't write " << json_path << '\n';
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,240 @@
+// Converts a search tree recorded by Solve (see solver_lib/search_tree.h and
+// SolveOptions::search_tree) for viewing and analysis.
+//
+// Usage: search_tree summary FILE [--path N]
+//                        totals, then the heaviest path: from the biggest
+//                        root, N steps (default 30) into the bigger child
+//        search_tree dot FILE [--root ID] [--depth D]
+//                        Graphviz input for the subtree of node ID (default
+//                        every root), D levels deep (default all)
+//        search_tree json FILE [--root ID] [--depth D]
+//                        the same as nested JSON objects
+//
+// Each node shows the guess that led to it, how it ended, the passes
+// through the constraints and the slots that propagation decided, and the
+// size of its subtree, which is where a search that blows up shows it.
+#include "solver_lib/search_tree.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Tree {
+    std::vector<SearchTreeNode> nodes;
+    std::vector<std::size_t> roots;
+    // The children of node i are children[starts[i]] up to starts[i+1].
+    std::vector<std::size_t> starts;
+    std::vector<std::size_t> children;
+    // Over each node's subtree, the node included.
+    std::vector<std::size_t> sizes;
+    std::vector<std::size_t> conflicts;
+    std::vector<std::size_t> solutions;
+
+    std::size_t Count() const { return nodes.size(); }
+};
+
+void Index(Tree &tree) {
+    const std::size_t count = tree.Count();
+    tree.starts.assign(count + 1, 0);
+    for (std::size_t i = 0; i < count; ++i) {
+        if (tree.nodes[i].parent == no_parent) {
+            tree.roots.push_back(i);
+        } else {
+            ++tree.starts[static_cast<std::size_t>(tree.nodes[i].parent) + 1];
+        }
+    }
+    for (std::size_t i = 0; i < count; ++i) tree.starts[i + 1] += tree.starts[i];
+    tree.children.resize(tree.starts[count]);
+    std::vector<std::size_t> next(tree.starts.begin(), tree.starts.end() - 1);
+    for (std::size_t i = 0; i < count; ++i) {
+        if (tree.nodes[i].parent != no_parent) {
+            tree.children[next[static_cast<std::size_t>(tree.nodes[i].parent)]++] = i;
+        }
+    }
+
+    // Parents come before their children, so a backward sweep sees every
+    // subtree complete.
+    tree.sizes.assign(count, 1);
+    tree.conflicts.assign(count, 0);
+    tree.solutions.assign(count, 0);
+    for (std::size_t i = count; i-- > 0; ) {
+        const SearchTreeNode &node = tree.nodes[i];
+        if (node.outcome == NodeOutcome::CONFLICT) ++tree.conflicts[i];
+        if (node.outcome == NodeOutcome::SOLUTION) ++tree.solutions[i];
+        if (node.parent == no_parent) continue;
+        const auto parent = static_cast<std::size_t>(node.parent);
+        tree.sizes[parent] += tree.sizes[i];
+        tree.conflicts[parent] += tree.conflicts[i];
+        tree.solutions[parent] += tree.solutions[i];
+    }
+}
+
+const char *OutcomeName(NodeOutcome outcome) {
+    switch (outcome) {
+        case NodeOutcome::CONFLICT: return "conflict";
+        case NodeOutcome::BRANCHED: return "branched";
+        case NodeOutcome::SOLUTION: return "solution";
+    }
+    return "unknown";
+}
+
+// "slot 12 = YES", or "root".
+std::string Guess(const SearchTreeNode &node) {
+    if (node.parent == no_parent) return "root";
+    return "slot " + std::to_string(node.slot) + (node.value > 0 ? " = YES" : " = NO");
+}
+
+int Summary(const Tree &tree, std::size_t steps) {
+    std::size_t conflicts = 0;
+    std::size_t solutions = 0;
+    std::uint64_t passes = 0;
+    for (const auto &node : tree.nodes) {
+        if (node.outcome == NodeOutcome::CONFLICT) ++conflicts;
+        if (node.outcome == NodeOutcome::SOLUTION) ++solutions;
+        passes += node.passes;
+    }
+    std::cout << tree.Count() << " nodes, " << tree.roots.size() << " roots, "
+              << conflicts << " conflicts, " << solutions << " solutions, "
+              << passes << " passes\n";
+    if (tree.roots.empty()) return 0;
+
+    // Follow the bigger child from the biggest root.  Where the sizes of
+    // the two children are lopsided, the guess made little difference to
+    // one side; where both are big, the search split a hard subproblem.
+    std::size_t at = *std::max_element(
+        tree.roots.begin(), tree.roots.end(),
+        [&](std::size_t a, std::size_t b) { return tree.sizes[a] < tree.sizes[b]; });
+    std::cout << "\nHeaviest path:\n"
+              << "depth         node  guess                 subtree  conflicts"
+                 "  solutions  passes  fixed  children\n";
+    for (std::size_t depth = 0; depth < steps; ++depth) {
+        const SearchTreeNode &node = tree.nodes[at];
+        std::cout << std::setw(5) << depth << ' ' << std::setw(12) << at << "  "
+                  << std::left << std::setw(20) << Guess(node) << std::right << ' '
+                  << std::setw(8) << tree.sizes[at] << ' '
+                  << std::setw(10) << tree.conflicts[at] << ' '
+                  << std::setw(10) << tree.solutions[at] << ' '
+                  << std::setw(7) << node.passes << ' '
+                  << std::setw(6) << node.fixed << ' ';
+        std::size_t heaviest = tree.Count();
+        for (std::size_t k = tree.starts[at]; k < tree.starts[at + 1]; ++k) {
+            const std::size_t child = tree.children[k];
+            std::cout << ' ' << tree.sizes[child];
+            if (heaviest == tree.Count() || tree.sizes[child] > tree.sizes[heaviest]) {
+                heaviest = child;
+            }
+        }
+        std::cout << '\n';
+        if (heaviest == tree.Count()) break;
+        at = heaviest;
+    }
+    return 0;
+}
+
+void WriteDot(const Tree &tree, std::size_t at, std::size_t depth) {
+    const SearchTreeNode &node = tree.nodes[at];
+    const char *color = node.outcome == NodeOutcome::CONFLICT ? "lightpink"
+                      : node.outcome == NodeOutcome::SOLUTION ? "palegreen" : "white";
+    std::cout << "  n" << at << " [label=\"" << Guess(node) << "\\n"
+              << tree.sizes[at] << " nodes, " << node.passes << " passes, "
+              << node.fixed << " fixed\", style=filled, fillcolor=" << color << "];\n";
+    if (depth == 0) return;
+    for (std::size_t k = tree.starts[at]; k < tree.starts[at + 1]; ++k) {
+        std::cout << "  n" << at << " -> n" << tree.children[k] << ";\n";
+        WriteDot(tree, tree.children[k], depth - 1);
+    }
+}
+
+void WriteJson(const Tree &tree, std::size_t at, std::size_t depth, int indent) {
+    const SearchTreeNode &node = tree.nodes[at];
+    const std::string pad(static_cast<std::size_t>(indent), ' ');
+    std::cout << pad << "{\"id\": " << at;
+    if (node.parent != no_parent) {
+        std::cout << ", \"slot\": " << node.slot
+                  << ", \"value\": \"" << (node.value > 0 ? "YES" : "NO") << '"';
+    }
+    std::cout << ", \"outcome\": \"" << OutcomeName(node.outcome) << '"'
+              << ", \"passes\": " << node.passes
+              << ", \"fixed\": " << node.fixed
+              << ", \"subtree\": " << tree.sizes[at]
+              << ", \"conflicts\": " << tree.conflicts[at]
+              << ", \"solutions\": " << tree.solutions[at];
+    if (depth > 0 && tree.starts[at] < tree.starts[at + 1]) {
+        std::cout << ", \"children\": [\n";
+        for (std::size_t k = tree.starts[at]; k < tree.starts[at + 1]; ++k) {
+            if (k != tree.starts[at]) std::cout << ",\n";
+            WriteJson(tree, tree.children[k], depth - 1, indent + 2);
+        }
+        std::cout << '\n' << pad << ']';
+    }
+    std::cout << '}';
+}
+
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 3) {
+        std::cerr << "Usage: search_tree summary FILE [--path N]\n"
+                     "       search_tree dot FILE [--root ID] [--depth D]\n"
+                     "       search_tree json FILE [--root ID] [--depth D]\n";
+        return 1;
+    }
+    const std::string mode = argv[1];
+    std::uint64_t root = no_parent;
+    std::size_t depth = static_cast<std::size_t>(-1);   // all
+    std::size_t steps = 30;
+    for (int i = 3; i + 1 < argc; i += 2) {
+        const char *value = argv[i + 1];
+        if (std::strcmp(argv[i], "--root") == 0) {
+            root = std::strtoull(value, nullptr, 10);
+        } else if (std::strcmp(argv[i], "--depth") == 0) {
+            depth = static_cast<std::size_t>(std::strtoull(value, nullptr, 10));
+        } else if (std::strcmp(argv[i], "--path") == 0) {
+            steps = static_cast<std::size_t>(std::strtoull(value, nullptr, 10));
+        } else {
+            std::cerr << "Unknown option " << argv[i] << '\n';
+            return 1;
+        }
+    }
+
+    Tree tree;
+    std::size_t slots = 0;
+    if (!ReadSearchTree(argv[2], tree.nodes, slots)) {
+        std::cerr << "Can't read a search tree from " << argv[2] << '\n';
+        return 1;
+    }
+    Index(tree);
+    if (root != no_parent && root >= tree.Count()) {
+        std::cerr << "There's no node " << root << '\n';
+        return 1;
+    }
+    const std::vector<std::size_t> tops =
+        root != no_parent ? std::vector<std::size_t>{static_cast<std::size_t>(root)}
+                          : tree.roots;
+
+    if (mode == "summary") {
+        std::cout << slots << " slots, ";
+        return Summary(tree, steps);
+    } else if (mode == "dot") {
+        std::cout << "digraph search {\n  node [shape=box, fontsize=10];\n";
+        for (const std::size_t top : tops) WriteDot(tree, top, depth);
+        std::cout << "}\n";
+    } else if (mode == "json") {
+        std::cout << "[\n";
+        for (std::size_t i = 0; i < tops.size(); ++i) {
+            if (i != 0) std::cout << ",\n";
+            WriteJson(tree, tops[i], depth, 2);
+        }
+        std::cout << "\n]\n";
+    } else {
+        std::cerr << "Unknown mode " << mode << '\n';
+        return 1;
+    }
+    return 0;
+}
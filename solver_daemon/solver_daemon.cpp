@@ -0,0 +1,391 @@
+// A long-running solver that keeps compiled rule sets in memory and solves
+// puzzle instances sent to it over a Unix domain socket, so that a request
+// costs neither a process launch nor building the puzzle.
+//
+// Usage: solver_daemon serve SOCKET [options]
+//   --rules NAME=FILE     keep the rules in FILE resident under NAME; FILE is
+//                         a flat model (Puzzle::Save, quasigroup --save-model)
+//                         or a grid description (grid_puzzle); may be repeated
+//   --threads T           solve on T threads (default 0, one per core)
+//   --node-limit L        give up on a request after L nodes, 0 for none
+//                         (default 0)
+//   --cache FILE          remember results in FILE, across restarts, and
+//                         answer repeated requests from it
+//
+//        solver_daemon client SOCKET
+//                         send the requests on standard input, print the
+//                         responses, and report how long they took
+//
+// The protocol is lines of text.  A request asks for up to LIMIT solutions
+// (0 for all) of the rules under the given literals, written as in cube
+// files:  k means slot k-1 is YES and -k means it's NO.
+//
+//   solve <id> <rules> <limit> <literals> 0
+//
+// Requests are queued for the threads as they arrive, so one connection can
+// send many without waiting, and the responses come back as each request is
+// solved, not necessarily in order, tagged with the request's id.  A
+// request's v lines are sent together with its s line, once it's done:
+//
+//   v <id> <slots that are YES, plus one> 0        one line per solution
+//   s <id> <solutions> <nodes> [gave-up]           when the request is done
+//   e <id> <message>                               if the request was bad
+#include "solver_lib/description.h"
+#include "solver_lib/flat_model.h"
+#include "solver_lib/result_cache.h"
+#include "solver_lib/solver.h"
+
+#include <iostream>
+
+#ifdef _WIN32
+
+int main() {
+    std::cerr << "solver_daemon needs Unix domain sockets, which this build "
+                 "doesn't support.\n";
+    return 1;
+}
+
+#else
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+// Reads lines from a socket.
+class LineReader {
+    public:
+        explicit LineReader(int fd) : m_fd(fd) {}
+
+        // Returns false at the end of the input.
+        bool Next(std::string &line) {
+            for (;;) {
+                const auto newline = m_buffer.find('\n', m_start);
+                if (newline != std::string::npos) {
+                    line.assign(m_buffer, m_start, newline - m_start);
+                    m_start = newline + 1;
+                    return true;
+                }
+                m_buffer.erase(0, m_start);
+                m_start = 0;
+                char chunk[4096];
+                const ssize_t n = recv(m_fd, chunk, sizeof chunk, 0);
+                if (n <= 0) {
+                    if (m_buffer.empty()) return false;
+                    line.swap(m_buffer);
+                    m_buffer.clear();
+                    return true;
+                }
+                m_buffer.append(chunk, static_cast<std::size_t>(n));
+            }
+        }
+
+    private:
+        int m_fd;
+        std::string m_buffer;
+        std::size_t m_start = 0;
+};
+
+bool SendAll(int fd, const std::string &text) {
+    std::size_t sent = 0;
+    while (sent < text.size()) {
+        const ssize_t n = send(fd, text.data() + sent, text.size() - sent,
+                               MSG_NOSIGNAL);
+        if (n <= 0) return false;
+        sent += static_cast<std::size_t>(n);
+    }
+    return true;
+}
+
+// A client connection.  Workers answering its requests share it, and the
+// socket closes when the last of them is done.
+class Connection {
+    public:
+        explicit Connection(int fd) : m_fd(fd) {}
+        ~Connection() { close(m_fd); }
+
+        int Descriptor() const { return m_fd; }
+
+        // Sends a whole response at once, so that responses to requests
+        // solved at the same time don't interleave.
+        void Respond(const std::string &response) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            SendAll(m_fd, response);
+        }
+
+    private:
+        int m_fd;
+        std::mutex m_mutex;
+};
+
+struct Job {
+    std::shared_ptr<Connection> connection;
+    std::string request;
+};
+
+class JobQueue {
+    public:
+        void Push(Job job) {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_jobs.push_back(std::move(job));
+            }
+            m_ready.notify_one();
+        }
+
+        Job Pop() {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_ready.wait(lock, [this]() { return !m_jobs.empty(); });
+            Job job = std::move(m_jobs.front());
+            m_jobs.pop_front();
+            return job;
+        }
+
+    private:
+        std::mutex m_mutex;
+        std::condition_variable m_ready;
+        std::deque<Job> m_jobs;
+};
+
+struct Rules {
+    std::unique_ptr<Puzzle> puzzle;
+    CacheKey fingerprint;
+};
+
+using RuleSets = std::map<std::string, Rules>;
+
+// Loads a flat model, or failing that, a grid description.
+std::unique_ptr<Puzzle> LoadRules(const std::string &path) {
+    if (auto model = FlatModel::Open(path)) {
+        return std::make_unique<Puzzle>(std::move(model));
+    }
+    std::ifstream in(path);
+    GridDescription description;
+    std::string error;
+    if (!in || !ReadDescription(in, description, error)) {
+        std::cerr << path << ": " << (error.empty() ? "can't read it" : error)
+                  << '\n';
+        return nullptr;
+    }
+    return std::make_unique<Puzzle>(description.model);
+}
+
+std::string Answer(const RuleSets &rules, const std::string &request,
+                   const SolveOptions &base, ResultCache *cache) {
+    std::istringstream in(request);
+    std::string command, id, name;
+    std::size_t limit = 0;
+    if (!(in >> command >> id)) return "e - empty request\n";
+    if (command != "solve") return "e " + id + " unknown request\n";
+    if (!(in >> name >> limit)) return "e " + id + " bad request\n";
+    const auto found = rules.find(name);
+    if (found == rules.end()) return "e " + id + " unknown rules " + name + '\n';
+    const Puzzle &puzzle = *found->second.puzzle;
+
+    // Every token up to the 0 has to be a whole number.
+    std::vector<Literal> literals;
+    std::string token;
+    bool ended = false;
+    while (in >> token) {
+        char *end = nullptr;
+        const long long k = std::strtoll(token.c_str(), &end, 10);
+        if (end == token.c_str() || *end != '\0') break;
+        if (k == 0) {
+            ended = true;
+            break;
+        }
+        // Negating LLONG_MIN would overflow, and a huge k would wrap around
+        // as an Index, so check the magnitude unsigned first.
+        const auto magnitude = k < 0 ? 0 - static_cast<unsigned long long>(k)
+                                     : static_cast<unsigned long long>(k);
+        if (magnitude > puzzle.SlotCount()) return "e " + id + " bad slot\n";
+        const auto index = static_cast<Index>(magnitude - 1);
+        literals.push_back(Literal{index, k < 0 ? NO : YES});
+    }
+    if (!ended) return "e " + id + " literals must end with 0\n";
+
+    SolveOptions options = base;
+    options.solution_limit = limit;
+    SolveStatistics stats;
+    const auto solutions =
+        cache != nullptr
+            ? cache->Solve(puzzle, found->second.fingerprint, literals, options,
+                           &stats)
+            : puzzle.Solve(literals, options, &stats);
+    std::ostringstream out;
+    for (const auto &s : solutions) {
+        out << "v " << id;
+        for (Index i = 0; i < s.size(); ++i) {
+            if (s[i] == YES) out << ' ' << i + 1;
+        }
+        out << " 0\n";
+    }
+    out << "s " << id << ' ' << solutions.size() << ' ' << stats.nodes
+        << (stats.gave_up ? " gave-up\n" : "\n");
+    return out.str();
+}
+
+int Serve(const char *path, const RuleSets &rules, std::size_t threads,
+          const SolveOptions &options, ResultCache *cache) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (std::strlen(path) >= sizeof address.sun_path) {
+        std::cerr << "The socket path is too long.\n";
+        return 1;
+    }
+    std::strcpy(address.sun_path, path);
+    const int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(path);  // left over from an earlier run
+    if (listener < 0 ||
+        bind(listener, reinterpret_cast<const sockaddr *>(&address),
+             sizeof address) != 0 ||
+        listen(listener, SOMAXCONN) != 0) {
+        std::cerr << "Can't listen on " << path << ": " << std::strerror(errno)
+                  << '\n';
+        return 1;
+    }
+
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    JobQueue queue;
+    std::vector<std::thread> workers;
+    for (std::size_t t = 0; t < threads; ++t) {
+        workers.emplace_back([&]() {
+            for (;;) {
+                const Job job = queue.Pop();
+                job.connection->Respond(
+                    Answer(rules, job.request, options, cache));
+            }
+        });
+    }
+    std::cerr << "Serving " << rules.size() << " rule sets on " << path
+              << " with " << threads << " threads\n";
+
+    // Each connection gets a thread that only reads its requests and queues
+    // them, so slow clients don't hold up the workers.
+    for (;;) {
+        const int fd = accept(listener, nullptr, nullptr);
+        if (fd < 0) continue;
+        auto connection = std::make_shared<Connection>(fd);
+        std::thread([&queue, connection]() {
+            LineReader reader(connection->Descriptor());
+            std::string line;
+            while (reader.Next(line)) {
+                if (!line.empty()) queue.Push(Job{connection, line});
+            }
+        }).detach();
+    }
+}
+
+int Client(const char *path) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (std::strlen(path) >= sizeof address.sun_path) {
+        std::cerr << "The socket path is too long.\n";
+        return 1;
+    }
+    std::strcpy(address.sun_path, path);
+    const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, reinterpret_cast<const sockaddr *>(&address),
+                          sizeof address) != 0) {
+        std::cerr << "Can't connect to " << path << ": "
+                  << std::strerror(errno) << '\n';
+        return 1;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    std::size_t requests = 0;
+    std::thread sender([&]() {
+        std::string line;
+        while (std::getline(std::cin, line)) {
+            if (line.empty()) continue;
+            ++requests;
+            if (!SendAll(fd, line + '\n')) break;
+        }
+        shutdown(fd, SHUT_WR);
+    });
+    LineReader reader(fd);
+    std::string line;
+    std::size_t responses = 0;
+    while (reader.Next(line)) {
+        std::cout << line << '\n';
+        if (line[0] == 's' || line[0] == 'e') ++responses;
+    }
+    sender.join();
+    close(fd);
+    const std::chrono::duration<double, std::milli> elapsed =
+        std::chrono::steady_clock::now() - start;
+    std::cerr << responses << " of " << requests << " requests answered in "
+              << elapsed.count() << " ms\n";
+    return responses == requests ? 0 : 1;
+}
+
+}
+
+int main(int argc, char *argv[]) {
+    if (argc >= 3 && std::strcmp(argv[1], "client") == 0) {
+        return Client(argv[2]);
+    }
+    if (argc < 3 || std::strcmp(argv[1], "serve") != 0) {
+        std::cerr << "Usage: solver_daemon serve SOCKET [--rules NAME=FILE]... "
+                     "[--threads T] [--node-limit L] [--cache FILE]\n"
+                     "       solver_daemon client SOCKET\n";
+        return 1;
+    }
+    RuleSets rules;
+    std::size_t threads = 0;
+    const char *cache_path = nullptr;
+    SolveOptions options;
+    options.trace = false;
+    for (int i = 3; i + 1 < argc; i += 2) {
+        const char *value = argv[i + 1];
+        if (std::strcmp(argv[i], "--rules") == 0) {
+            const char *equals = std::strchr(value, '=');
+            if (equals == nullptr) {
+                std::cerr << "--rules takes NAME=FILE\n";
+                return 1;
+            }
+            Rules loaded{LoadRules(equals + 1), {}};
+            if (!loaded.puzzle) return 1;
+            // Rules from these files can always be flattened.
+            Fingerprint(*loaded.puzzle, loaded.fingerprint);
+            rules[std::string(value, equals)] = std::move(loaded);
+        } else if (std::strcmp(argv[i], "--threads") == 0) {
+            threads = std::strtoull(value, nullptr, 10);
+        } else if (std::strcmp(argv[i], "--node-limit") == 0) {
+            options.node_limit = std::strtoull(value, nullptr, 10);
+        } else if (std::strcmp(argv[i], "--cache") == 0) {
+            cache_path = value;
+        } else {
+            std::cerr << "Unknown option " << argv[i] << '\n';
+            return 1;
+        }
+    }
+    std::unique_ptr<ResultCache> cache;
+    if (cache_path != nullptr) {
+        cache = std::make_unique<ResultCache>(1 << 16, cache_path);
+        if (!cache->Persistent()) {
+            std::cerr << "Can't use " << cache_path << " as a cache.\n";
+            return 1;
+        }
+    }
+    return Serve(argv[2], rules, threads, options, cache.get());
+}
+
+#endif
@@ -0,0 +1,152 @@
+#include "allocation_tracker.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <new>
+#include <ostream>
+
+namespace {
+
+// Both are constant-initialized, so operator new can use them from the
+// start, on any thread.
+thread_local AllocationTracker *innermost = nullptr;
+thread_local AllocationPhase current_phase = AllocationPhase::CONSTRUCTION;
+
+}
+
+AllocationCounts &AllocationCounts::operator+=(const AllocationCounts &other) {
+    allocations += other.allocations;
+    bytes += other.bytes;
+    peak_bytes = std::max(peak_bytes, other.peak_bytes);
+    return *this;
+}
+
+AllocationCounts &AllocationStatistics::operator[](AllocationPhase phase) {
+    switch (phase) {
+        case AllocationPhase::PROPAGATION: return propagation;
+        case AllocationPhase::BRANCHING: return branching;
+        case AllocationPhase::SOLUTIONS: return solutions;
+        case AllocationPhase::CONSTRUCTION: break;
+    }
+    return construction;
+}
+
+AllocationStatistics &AllocationStatistics::operator+=(const AllocationStatistics &other) {
+    construction += other.construction;
+    propagation += other.propagation;
+    branching += other.branching;
+    solutions += other.solutions;
+    return *this;
+}
+
+std::size_t AllocationStatistics::PeakBytes() const {
+    return std::max({construction.peak_bytes, propagation.peak_bytes,
+                     branching.peak_bytes, solutions.peak_bytes});
+}
+
+AllocationPhaseScope::AllocationPhaseScope(AllocationPhase phase) :
+    m_previous(current_phase)
+{
+    current_phase = phase;
+}
+
+AllocationPhaseScope::~AllocationPhaseScope() { current_phase = m_previous; }
+
+AllocationTracker::AllocationTracker() : m_outer(innermost) { innermost = this; }
+
+// Trackers are destroyed in the reverse order of their creation, on the
+// thread that created them.
+AllocationTracker::~AllocationTracker() { innermost = m_outer; }
+
+void AllocationTracker::Allocated(AllocationPhase phase, std::size_t bytes) {
+    AllocationCounts &counts = m_statistics[phase];
+    ++counts.allocations;
+    counts.bytes += bytes;
+    m_live += static_cast<long long>(bytes);
+    if (m_live > 0) {
+        counts.peak_bytes = std::max(counts.peak_bytes, static_cast<std::size_t>(m_live));
+    }
+    if (m_outer != nullptr) m_outer->Allocated(phase, bytes);
+}
+
+void AllocationTracker::Freed(std::size_t bytes) {
+    m_live -= static_cast<long long>(bytes);
+    if (m_outer != nullptr) m_outer->Freed(bytes);
+}
+
+std::ostream &operator<<(std::ostream &out, const AllocationStatistics &statistics) {
+    const struct {
+        const char *name;
+        const AllocationCounts &counts;
+    } phases[] = {
+        {"construction", statistics.construction},
+        {"propagation", statistics.propagation},
+        {"branching", statistics.branching},
+        {"solutions", statistics.solutions}
+    };
+    for (const auto &phase : phases) {
+        out << std::setw(14) << phase.name << ": "
+            << std::setw(10) << phase.counts.allocations << " allocations, "
+            << std::setw(12) << phase.counts.bytes << " bytes, peak "
+            << std::setw(12) << phase.counts.peak_bytes << " bytes\n";
+    }
+    return out;
+}
+
+#ifdef SOLVER_TRACK_ALLOCATIONS
+
+bool TrackingAllocations() { return true; }
+
+namespace {
+
+// Each block starts with its size, padded to keep the rest aligned.
+constexpr std::size_t header_size = alignof(std::max_align_t);
+
+void *Allocate(std::size_t size) {
+    void *block = std::malloc(size + header_size);
+    if (block == nullptr) return nullptr;
+    *static_cast<std::size_t *>(block) = size;
+    if (innermost != nullptr) innermost->Allocated(current_phase, size);
+    return static_cast<char *>(block) + header_size;
+}
+
+void Free(void *pointer) {
+    if (pointer == nullptr) return;
+    void *block = static_cast<char *>(pointer) - header_size;
+    if (innermost != nullptr) innermost->Freed(*static_cast<std::size_t *>(block));
+    std::free(block);
+}
+
+}
+
+// The replaceable forms without alignment.  The aligned ones keep their
+// defaults, which allocate separately.
+void *operator new(std::size_t size) {
+    void *pointer = Allocate(size);
+    if (pointer == nullptr) throw std::bad_alloc();
+    return pointer;
+}
+
+void *operator new[](std::size_t size) { return operator new(size); }
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept {
+    return Allocate(size);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept {
+    return Allocate(size);
+}
+
+void operator delete(void *pointer) noexcept { Free(pointer); }
+void operator delete[](void *pointer) noexcept { Free(pointer); }
+void operator delete(void *pointer, std::size_t) noexcept { Free(pointer); }
+void operator delete[](void *pointer, std::size_t) noexcept { Free(pointer); }
+void operator delete(void *pointer, const std::nothrow_t &) noexcept { Free(pointer); }
+void operator delete[](void *pointer, const std::nothrow_t &) noexcept { Free(pointer); }
+
+#else
+
+bool TrackingAllocations() { return false; }
+
+#endif
@@ -0,0 +1,87 @@
+// Counting heap allocations by phase.  Counting only happens when
+// solver_lib is compiled with SOLVER_TRACK_ALLOCATIONS defined, which
+// replaces the global operator new and delete.  Otherwise the counts stay
+// zero, and the rest of this costs next to nothing.
+#ifndef ALLOCATION_TRACKER_H
+#define ALLOCATION_TRACKER_H
+
+#include <cstddef>
+#include <iosfwd>
+
+// What a thread is doing, as far as its allocations are concerned.  Solve
+// sets the phases of the search; everything else, such as building the
+// puzzle, counts as construction.
+enum class AllocationPhase {
+    CONSTRUCTION,
+    PROPAGATION,
+    BRANCHING,      // copying candidates and keeping the stack of nodes
+    SOLUTIONS       // collecting the solutions
+};
+
+struct AllocationCounts {
+    std::size_t allocations = 0;
+    std::size_t bytes = 0;
+    // The most bytes that were live at once while in this phase, counting
+    // those allocated on the tracking thread since tracking started.
+    std::size_t peak_bytes = 0;
+
+    // Adds the counts and keeps the larger peak.
+    AllocationCounts &operator+=(const AllocationCounts &other);
+};
+
+struct AllocationStatistics {
+    AllocationCounts construction;
+    AllocationCounts propagation;
+    AllocationCounts branching;
+    AllocationCounts solutions;
+
+    AllocationCounts &operator[](AllocationPhase phase);
+    AllocationStatistics &operator+=(const AllocationStatistics &other);
+    // The most bytes live at once, in any phase.
+    std::size_t PeakBytes() const;
+};
+
+// True if solver_lib was compiled with SOLVER_TRACK_ALLOCATIONS.
+bool TrackingAllocations();
+
+// Sets the thread's phase until it goes out of scope.
+class AllocationPhaseScope {
+    public:
+        explicit AllocationPhaseScope(AllocationPhase phase);
+        ~AllocationPhaseScope();
+        AllocationPhaseScope(const AllocationPhaseScope &) = delete;
+        AllocationPhaseScope &operator=(const AllocationPhaseScope &) = delete;
+
+    private:
+        AllocationPhase m_previous;
+};
+
+// Counts the allocations made by the thread that creates it, until it's
+// destroyed.  Trackers nest; each counts everything that happens while it
+// exists.  Memory freed on another thread than it was allocated on isn't
+// subtracted from the live bytes.
+class AllocationTracker {
+    public:
+        AllocationTracker();
+        ~AllocationTracker();
+        AllocationTracker(const AllocationTracker &) = delete;
+        AllocationTracker &operator=(const AllocationTracker &) = delete;
+
+        const AllocationStatistics &Statistics() const { return m_statistics; }
+
+        // Called by operator new and delete.
+        void Allocated(AllocationPhase phase, std::size_t bytes);
+        void Freed(std::size_t bytes);
+
+    private:
+        AllocationTracker *m_outer;
+        AllocationStatistics m_statistics;
+        // Can go below zero when memory allocated before this tracker is
+        // freed.
+        long long m_live = 0;
+};
+
+// One line per phase:  allocations, bytes, and peak bytes.
+std::ostream &operator<<(std::ostream &out, const AllocationStatistics &statistics);
+
+#endif
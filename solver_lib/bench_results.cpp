@@ -0,0 +1,223 @@
+#include "bench_results.h"
+
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <ostream>
+#include <sstream>
+
+namespace {
+
+constexpr const char *format = "solver-bench-1";
+
+void WriteString(std::ostream &out, const std::string &text) {
+    out << '"';
+    for (const char ch : text) {
+        if (ch == '"' || ch == '\\') out << '\\';
+        out << ch;
+    }
+    out << '"';
+}
+
+// Just enough JSON for the results:  objects, arrays, strings without
+// Unicode escapes, and numbers.  Anything else only needs to be skipped.
+class Parser {
+    public:
+        explicit Parser(const std::string &text) : m_text(text) {}
+
+        bool Results(BenchResults &results) {
+            bool formatted = false;
+            const bool parsed = Object([&](const std::string &key) {
+                if (key == "format") {
+                    std::string name;
+                    if (!String(name)) return false;
+                    formatted = name == format;
+                    return formatted || Fail("format " + name + ", not " + format);
+                } else if (key == "suite") {
+                    return String(results.suite);
+                } else if (key == "benchmarks") {
+                    return Array([&] {
+                        results.benchmarks.emplace_back();
+                        return Benchmark(results.benchmarks.back());
+                    });
+                }
+                return Skip();
+            });
+            if (!parsed) return false;
+            Space();
+            if (m_at != m_text.size()) return Fail("text after the results");
+            return formatted || Fail("no format");
+        }
+
+        const std::string &Error() const { return m_error; }
+
+    private:
+        bool Benchmark(BenchResult &result) {
+            return Object([&](const std::string &key) {
+                if (key == "name") return String(result.name);
+                if (key == "nodes") return Count(result.nodes);
+                if (key == "peak_bytes") return Count(result.peak_bytes);
+                if (key == "ms") {
+                    return Array([&] {
+                        double ms = 0;
+                        if (!Number(ms)) return false;
+                        result.milliseconds.push_back(ms);
+                        return true;
+                    });
+                }
+                return Skip();
+            });
+        }
+
+        template <typename Member>
+        bool Object(Member member) {
+            if (!Take('{')) return Fail("expected an object");
+            if (Take('}')) return true;
+            do {
+                std::string key;
+                if (!String(key)) return false;
+                if (!Take(':')) return Fail("expected ':'");
+                if (!member(key)) return false;
+            } while (Take(','));
+            return Take('}') || Fail("expected '}'");
+        }
+
+        template <typename Element>
+        bool Array(Element element) {
+            if (!Take('[')) return Fail("expected an array");
+            if (Take(']')) return true;
+            do {
+                if (!element()) return false;
+            } while (Take(','));
+            return Take(']') || Fail("expected ']'");
+        }
+
+        bool String(std::string &text) {
+            if (!Take('"')) return Fail("expected a string");
+            text.clear();
+            while (m_at < m_text.size() && m_text[m_at] != '"') {
+                if (m_text[m_at] == '\\' && ++m_at == m_text.size()) break;
+                text += m_text[m_at++];
+            }
+            if (m_at == m_text.size()) return Fail("unfinished string");
+            ++m_at;
+            return true;
+        }
+
+        bool Number(double &value) {
+            Space();
+            const char *start = m_text.c_str() + m_at;
+            char *end = nullptr;
+            value = std::strtod(start, &end);
+            if (end == start) return Fail("expected a number");
+            m_at += static_cast<std::size_t>(end - start);
+            return true;
+        }
+
+        bool Count(std::size_t &value) {
+            double number = 0;
+            if (!Number(number)) return false;
+            if (number < 0) return Fail("expected a count");
+            value = static_cast<std::size_t>(number);
+            return true;
+        }
+
+        // Any value.
+        bool Skip() {
+            Space();
+            if (m_at == m_text.size()) return Fail("expected a value");
+            const char ch = m_text[m_at];
+            if (ch == '{') return Object([&](const std::string &) { return Skip(); });
+            if (ch == '[') return Array([&] { return Skip(); });
+            if (ch == '"') {
+                std::string ignored;
+                return String(ignored);
+            }
+            if (std::isalpha(static_cast<unsigned char>(ch))) {
+                while (m_at < m_text.size() &&
+                       std::isalpha(static_cast<unsigned char>(m_text[m_at]))) {
+                    ++m_at;
+                }
+                return true;
+            }
+            double ignored = 0;
+            return Number(ignored);
+        }
+
+        bool Take(char ch) {
+            Space();
+            if (m_at == m_text.size() || m_text[m_at] != ch) return false;
+            ++m_at;
+            return true;
+        }
+
+        void Space() {
+            while (m_at < m_text.size() &&
+                   std::isspace(static_cast<unsigned char>(m_text[m_at]))) {
+                ++m_at;
+            }
+        }
+
+        bool Fail(const std::string &reason) {
+            if (m_error.empty()) {
+                m_error = reason + " at offset " + std::to_string(m_at);
+            }
+            return false;
+        }
+
+        const std::string &m_text;
+        std::size_t m_at = 0;
+        std::string m_error;
+};
+
+}
+
+void WriteBenchResults(std::ostream &out, const BenchResults &results) {
+    const auto flags = out.flags();
+    const auto precision = out.precision();
+    out << "{\"format\": \"" << format << "\", \"suite\": ";
+    WriteString(out, results.suite);
+    out << ", \"benchmarks\": [\n" << std::fixed << std::setprecision(4);
+    for (std::size_t i = 0; i < results.benchmarks.size(); ++i) {
+        const BenchResult &result = results.benchmarks[i];
+        out << "  {\"name\": ";
+        WriteString(out, result.name);
+        out << ", \"ms\": [";
+        for (std::size_t k = 0; k < result.milliseconds.size(); ++k) {
+            out << (k == 0 ? "" : ", ") << result.milliseconds[k];
+        }
+        out << "], \"nodes\": " << result.nodes
+            << ", \"peak_bytes\": " << result.peak_bytes << '}'
+            << (i + 1 < results.benchmarks.size() ? ",\n" : "\n");
+    }
+    out << "]}\n";
+    out.flags(flags);
+    out.precision(precision);
+}
+
+bool WriteBenchResults(const std::string &path, const BenchResults &results) {
+    std::ofstream out(path, std::ios::trunc);
+    WriteBenchResults(out, results);
+    out.flush();
+    return static_cast<bool>(out);
+}
+
+bool ReadBenchResults(const std::string &path, BenchResults &results,
+                      std::string &error) {
+    std::ifstream in(path);
+    if (!in) {
+        error = "can't read it";
+        return false;
+    }
+    std::ostringstream text;
+    text << in.rdbuf();
+    const std::string contents = text.str();
+    results = BenchResults{};
+    Parser parser(contents);
+    if (!parser.Results(results)) {
+        error = parser.Error();
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,40 @@
+// Benchmark results in a stable JSON format, for comparing a build against
+// a baseline (see bench_compare).
+#ifndef BENCH_RESULTS_H
+#define BENCH_RESULTS_H
+
+#include <cstddef>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+// One benchmark:  the time of each repetition, and the nodes and memory,
+// which don't change from one repetition to the next.
+struct BenchResult {
+    std::string name;           // unique within the file, such as "sudoku/4/2"
+    std::vector<double> milliseconds;
+    std::size_t nodes = 0;
+    std::size_t peak_bytes = 0; // zero unless solver_lib tracks allocations
+};
+
+struct BenchResults {
+    std::string suite;          // the command that produced them
+    std::vector<BenchResult> benchmarks;
+};
+
+// The file is a JSON object with "format": "solver-bench-1", the suite,
+// and one line per benchmark, in the order given:
+//
+//   {"format": "solver-bench-1", "suite": "sudoku bench", "benchmarks": [
+//     {"name": "sudoku/3/1", "ms": [1.25, 1.19], "nodes": 12, "peak_bytes": 0},
+//     ...
+//   ]}
+void WriteBenchResults(std::ostream &out, const BenchResults &results);
+bool WriteBenchResults(const std::string &path, const BenchResults &results);
+
+// Accepts any JSON with that structure.  Returns false, with a reason in
+// error, if the file can't be read or has something else in it.
+bool ReadBenchResults(const std::string &path, BenchResults &results,
+                      std::string &error);
+
+#endif
@@ -0,0 +1,252 @@
+#include "checkpoint.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+
+// The file starts with a magic number and a version, and everything after
+// that is unsigned integers in LEB128 (seven bits per byte, low bits first,
+// with the high bit set on all but the last byte).  Lists are preceded by
+// their lengths, a literal is its index times two, plus one if it's YES, and
+// a double is its bits.
+// Each candidate's guesses share a prefix with the previous candidate's, so
+// only the length of the shared prefix and the rest are stored.
+
+namespace {
+
+constexpr char magic[4] = {'P', 'Z', 'C', 'K'};
+constexpr std::uint64_t version = 2;
+
+class Writer {
+    public:
+        explicit Writer(std::ostream &out) : m_out(out) {}
+
+        void Number(std::uint64_t n) {
+            while (n >= 0x80) {
+                m_out.put(static_cast<char>((n & 0x7f) | 0x80));
+                n >>= 7;
+            }
+            m_out.put(static_cast<char>(n));
+        }
+
+        void Flag(bool b) { Number(b ? 1 : 0); }
+
+        void Literals(const std::vector<Literal> &literals, std::size_t from = 0) {
+            Number(literals.size() - from);
+            for (std::size_t i = from; i < literals.size(); ++i) {
+                Number(literals[i].index * 2 + (literals[i].value == YES ? 1 : 0));
+            }
+        }
+
+        void Numbers(const std::vector<std::size_t> &numbers) {
+            Number(numbers.size());
+            for (const auto n : numbers) Number(n);
+        }
+
+        void Text(const std::string &text) {
+            Number(text.size());
+            m_out.write(text.data(), static_cast<std::streamsize>(text.size()));
+        }
+
+    private:
+        std::ostream &m_out;
+};
+
+class Reader {
+    public:
+        Reader(std::istream &in, std::uintmax_t size) : m_in(in), m_size(size) {}
+
+        bool Ok() const { return m_ok; }
+
+        std::size_t Number() { return static_cast<std::size_t>(Wide()); }
+
+        // A number that needn't fit in a size_t.
+        std::uint64_t Wide() {
+            std::uint64_t n = 0;
+            for (int shift = 0; m_ok; shift += 7) {
+                const int c = m_in.get();
+                if (c == EOF || shift > 63) {
+                    m_ok = false;
+                    break;
+                }
+                n |= static_cast<std::uint64_t>(c & 0x7f) << shift;
+                if ((c & 0x80) == 0) break;
+            }
+            return n;
+        }
+
+        bool Flag() { return Number() != 0; }
+
+        // Reads a count, failing if there aren't enough bytes left for that
+        // many items.
+        std::size_t Count() {
+            const std::size_t n = Number();
+            const auto position = static_cast<std::uintmax_t>(m_in.tellg());
+            if (!m_ok || position > m_size || n > m_size - position) m_ok = false;
+            return m_ok ? n : 0;
+        }
+
+        void Literals(std::vector<Literal> &literals) {
+            for (std::size_t k = Count(); m_ok && k > 0; --k) {
+                const std::size_t n = Number();
+                literals.push_back(Literal{n / 2, (n & 1) ? YES : NO});
+            }
+        }
+
+        void Numbers(std::vector<std::size_t> &numbers) {
+            for (std::size_t k = Count(); m_ok && k > 0; --k) {
+                numbers.push_back(Number());
+            }
+        }
+
+        void Text(std::string &text) {
+            text.resize(Count());
+            m_in.read(text.data(), static_cast<std::streamsize>(text.size()));
+            if (!m_in) m_ok = false;
+        }
+
+    private:
+        std::istream &m_in;
+        std::uintmax_t m_size;
+        bool m_ok = true;
+};
+
+std::size_t SharedPrefix(const std::vector<Literal> &a,
+                         const std::vector<Literal> &b) {
+    std::size_t n = 0;
+    while (n < a.size() && n < b.size() &&
+           a[n].index == b[n].index && a[n].value == b[n].value) {
+        ++n;
+    }
+    return n;
+}
+
+}
+
+bool WriteCheckpoint(const std::string &path, const Checkpoint &checkpoint) {
+    const std::string temporary = path + ".tmp";
+    {
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+        out.write(magic, sizeof magic);
+        Writer w(out);
+        w.Number(version);
+        w.Number(checkpoint.slots);
+        w.Number(checkpoint.constraints);
+        w.Number(checkpoint.fingerprint.a);
+        w.Number(checkpoint.fingerprint.b);
+
+        const SolveStatistics &c = checkpoint.counts;
+        for (const auto n : {c.nodes, c.guesses, c.conflicts, c.solutions,
+                             c.passes, c.propagated, c.max_passes, c.max_depth,
+                             c.max_candidates, c.restarts, c.nogoods_learned,
+                             c.nogoods_imported, c.replayed}) {
+            w.Number(n);
+        }
+        w.Flag(c.gave_up);
+        w.Flag(c.cancelled);
+        w.Number(std::bit_cast<std::uint64_t>(c.seconds));
+        w.Number(std::bit_cast<std::uint64_t>(c.propagation_seconds));
+
+        w.Number(checkpoint.run);
+        w.Number(checkpoint.conflicts);
+        w.Number(std::bit_cast<std::uint64_t>(checkpoint.done));
+        w.Text(checkpoint.rng);
+        w.Numbers(checkpoint.weights);
+        w.Number(checkpoint.nogoods.size());
+        for (const auto &nogood : checkpoint.nogoods) w.Literals(nogood);
+
+        w.Number(checkpoint.frontier.size());
+        const std::vector<Literal> none;
+        const std::vector<Literal> *before = &none;
+        for (const auto &path_to : checkpoint.frontier) {
+            const std::size_t shared = SharedPrefix(*before, path_to);
+            w.Number(shared);
+            w.Literals(path_to, shared);
+            before = &path_to;
+        }
+        w.Literals(checkpoint.previous);
+        w.Numbers(checkpoint.found_before);
+
+        w.Number(checkpoint.solutions.size());
+        for (const auto &yes : checkpoint.solutions) w.Numbers(yes);
+        out.flush();
+        if (!out) return false;
+    }
+    std::error_code error;
+    std::filesystem::rename(temporary, path, error);
+    return !error;
+}
+
+bool ReadCheckpoint(const std::string &path, Checkpoint &checkpoint) {
+    std::error_code error;
+    const std::uintmax_t size = std::filesystem::file_size(path, error);
+    if (error) return false;
+    std::ifstream in(path, std::ios::binary);
+    char header[sizeof magic] = {};
+    in.read(header, sizeof header);
+    if (!in || !std::equal(header, header + sizeof header, magic)) return false;
+    Reader r(in, size);
+    if (r.Number() != version) return false;
+    checkpoint = Checkpoint{};
+    checkpoint.slots = r.Number();
+    checkpoint.constraints = r.Number();
+    checkpoint.fingerprint.a = r.Wide();
+    checkpoint.fingerprint.b = r.Wide();
+
+    SolveStatistics &c = checkpoint.counts;
+    for (auto *n : {&c.nodes, &c.guesses, &c.conflicts, &c.solutions,
+                    &c.passes, &c.propagated, &c.max_passes, &c.max_depth,
+                    &c.max_candidates, &c.restarts, &c.nogoods_learned,
+                    &c.nogoods_imported, &c.replayed}) {
+        *n = r.Number();
+    }
+    c.gave_up = r.Flag();
+    c.cancelled = r.Flag();
+    c.seconds = std::bit_cast<double>(r.Wide());
+    c.propagation_seconds = std::bit_cast<double>(r.Wide());
+
+    checkpoint.run = r.Number();
+    checkpoint.conflicts = r.Number();
+    checkpoint.done = std::bit_cast<double>(r.Wide());
+    r.Text(checkpoint.rng);
+    r.Numbers(checkpoint.weights);
+    checkpoint.nogoods.resize(r.Count());
+    for (auto &nogood : checkpoint.nogoods) r.Literals(nogood);
+
+    checkpoint.frontier.resize(r.Count());
+    for (std::size_t k = 0; r.Ok() && k < checkpoint.frontier.size(); ++k) {
+        const std::size_t shared = r.Number();
+        if (k == 0 ? shared != 0 : shared > checkpoint.frontier[k-1].size()) {
+            return false;
+        }
+        auto &path_to = checkpoint.frontier[k];
+        if (k > 0) {
+            path_to.assign(checkpoint.frontier[k-1].begin(),
+                           checkpoint.frontier[k-1].begin() +
+                               static_cast<std::ptrdiff_t>(shared));
+        }
+        r.Literals(path_to);
+    }
+    r.Literals(checkpoint.previous);
+    r.Numbers(checkpoint.found_before);
+
+    checkpoint.solutions.resize(r.Count());
+    for (auto &yes : checkpoint.solutions) r.Numbers(yes);
+    if (!r.Ok()) return false;
+
+    // Reject indexes outside the puzzle.
+    auto const valid = [&](const std::vector<Literal> &literals) {
+        for (const auto &literal : literals) {
+            if (literal.index >= checkpoint.slots) return false;
+        }
+        return true;
+    };
+    for (const auto &nogood : checkpoint.nogoods) if (!valid(nogood)) return false;
+    for (const auto &path_to : checkpoint.frontier) if (!valid(path_to)) return false;
+    for (const auto &yes : checkpoint.solutions) {
+        for (const Index i : yes) if (i >= checkpoint.slots) return false;
+    }
+    return valid(checkpoint.previous);
+}
@@ -0,0 +1,43 @@
+// Saving the state of a search to a file so that it can be resumed later.
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include "solver_lib/result_cache.h"
+#include "solver_lib/solver.h"
+
+#include <string>
+#include <vector>
+
+// Everything Solve needs to pick up where it left off.  Candidates are
+// stored as the guesses that lead to them and rebuilt by replaying those.
+struct Checkpoint {
+    std::size_t slots = 0;
+    std::size_t constraints = 0;
+    // Of the constraints (see result_cache.h), or zero if they can't be
+    // flattened, so a checkpoint isn't resumed on a different puzzle.
+    CacheKey fingerprint;
+    SolveStatistics counts;
+    std::size_t run = 1;            // of the restart schedule
+    std::size_t conflicts = 0;      // in this run
+    double done = 0;                // the part of this run's tree finished
+    std::string rng;                // the random generator's state
+    std::vector<std::size_t> weights;
+    std::vector<std::vector<Literal>> nogoods;
+    // The open candidates, from the bottom of the stack to the top.
+    std::vector<std::vector<Literal>> frontier;
+    // The guesses that led to the last candidate explored, and the number
+    // of solutions found before reaching each level of them.
+    std::vector<Literal> previous;
+    std::vector<std::size_t> found_before;
+    // The YES slots of each solution found so far.
+    std::vector<IndexList> solutions;
+};
+
+// Writes the checkpoint to a temporary file and then renames it, so an
+// interruption never leaves a partial file behind.  Returns false on failure.
+bool WriteCheckpoint(const std::string &path, const Checkpoint &checkpoint);
+
+// Returns false if the file can't be read or isn't a checkpoint.
+bool ReadCheckpoint(const std::string &path, Checkpoint &checkpoint);
+
+#endif
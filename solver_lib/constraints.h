@@ -3,6 +3,8 @@
 #define CONSTRAINTS_H
 
 #include "solver_lib/solver.h"
+#include "solver_lib/flat_model.h"
+#include "solver_lib/kernels.h"
 
 #include <algorithm>
 #include <cassert>
@@ -17,7 +19,17 @@ class Fixed : public Puzzle::BasicConstraint {
         }
 
         Result Evaluate(Solution &s) const override {
-            return s.Set(m_index, m_value);
+            return EvaluateFixed(s, m_index, m_value);
+        }
+
+        void AppendScope(IndexList &scope) const override {
+            scope.push_back(m_index);
+        }
+
+        bool Flatten(FlatModelBuilder &model) const override {
+            model.Begin(ConstraintKind::FIXED, m_value);
+            model.Append(m_index);
+            return true;
         }
 
     private:
@@ -33,10 +45,19 @@ class IfPThenQ : public Puzzle::BasicConstraint {
             BasicConstraint(name), m_p(P), m_q(Q) {}
 
         Result Evaluate(Solution &s) const override {
-            if (s[m_p] == YES && s[m_q] == NO) return Result::CONFLICT;
-            if (s[m_p] == YES && s[m_q] == MAYBE) return s.Set(m_q, YES);
-            if (s[m_q] == NO  && s[m_p] == MAYBE) return s.Set(m_p, NO);
-            return Result::NO_CHANGE;
+            return EvaluateIfPThenQ(s, m_p, m_q);
+        }
+
+        void AppendScope(IndexList &scope) const override {
+            scope.push_back(m_p);
+            scope.push_back(m_q);
+        }
+
+        bool Flatten(FlatModelBuilder &model) const override {
+            model.Begin(ConstraintKind::IF_P_THEN_Q);
+            model.Append(m_p);
+            model.Append(m_q);
+            return true;
         }
 
     private:
@@ -56,20 +77,20 @@ class Identical : public Puzzle::BasicConstraint {
 
         Result Evaluate(Solution &s) const override {
             assert(m_indexes1.size() == m_indexes2.size());
-            Result result = Result::NO_CHANGE;
-            for (Index i = 0; i < m_indexes1.size(); ++i) {
-                if (s[m_indexes1[i]] == YES && s[m_indexes2[i]] == NO) return Result::CONFLICT;
-                if (s[m_indexes2[i]] == YES && s[m_indexes1[i]] == NO) return Result::CONFLICT;
-                if (s[m_indexes1[i]] == MAYBE && s[m_indexes2[i]] != MAYBE) {
-                    s.Set(m_indexes1[i], s[m_indexes2[i]]);
-                    result = Result::PROGRESS;
-                }
-                if (s[m_indexes2[i]] == MAYBE && s[m_indexes1[i]] != MAYBE) {
-                    s.Set(m_indexes2[i], s[m_indexes1[i]]);
-                    result = Result::PROGRESS;
-                }
-            }
-            return result;
+            return EvaluateIdentical(s, m_indexes1.begin(), m_indexes2.begin(),
+                                     m_indexes1.size());
+        }
+
+        void AppendScope(IndexList &scope) const override {
+            scope.insert(scope.end(), m_indexes1.begin(), m_indexes1.end());
+            scope.insert(scope.end(), m_indexes2.begin(), m_indexes2.end());
+        }
+
+        bool Flatten(FlatModelBuilder &model) const override {
+            model.Begin(ConstraintKind::IDENTICAL);
+            model.Append(m_indexes1.begin(), m_indexes1.end());
+            model.Append(m_indexes2.begin(), m_indexes2.end());
+            return true;
         }
 
     private:
@@ -87,25 +108,49 @@ class ExactlyNOf : public Puzzle::BasicConstraint {
             m_number(n), m_indexes(std::move(indexes)), m_value(value) {}
 
         Result Evaluate(Solution &s) const override {
-            const std::size_t matches = s.Count(m_indexes, m_value);
-            const std::size_t maybes = s.Count(m_indexes, MAYBE);
-            if (maybes < m_number - matches) return Result::CONFLICT;
-            if (matches > m_number) return Result::CONFLICT;
-            if (maybes > 0) {
-                if (matches == m_number) {
-                    for (Index index : m_indexes) {
-                        if (s[index] == MAYBE) s.Set(index, !m_value);
-                    }
-                    return Result::PROGRESS;
-                }
-                if (maybes == m_number - matches) {
-                    for (Index index : m_indexes) {
-                        if (s[index] == MAYBE) s.Set(index, m_value);
-                    }
-                    return Result::PROGRESS;
-                }
-            }
-            return Result::NO_CHANGE;
+            return EvaluateExactlyNOf(s, m_indexes.begin(), m_indexes.end(),
+                                      m_number, m_value);
+        }
+
+        void AppendScope(IndexList &scope) const override {
+            scope.insert(scope.end(), m_indexes.begin(), m_indexes.end());
+        }
+
+        bool Flatten(FlatModelBuilder &model) const override {
+            model.Begin(ConstraintKind::EXACTLY_N_OF, m_value, m_number);
+            model.Append(m_indexes.begin(), m_indexes.end());
+            return true;
+        }
+
+    private:
+        std::size_t m_number;
+        IndexList m_indexes;
+        Truth m_value;
+};
+
+// At most n of a specific subset of values in a solution may be a specific
+// value.  Once n of them are, the others in that subset must have the opposite
+// value.  With n = 1, this is the "no two queens on a diagonal" rule, which
+// ExactlyNOf can't express because a diagonal may be empty.
+class AtMostNOf : public Puzzle::BasicConstraint {
+    public:
+        AtMostNOf(const std::string &name, Index n, IndexList &&indexes, Truth value = YES) :
+            BasicConstraint(name),
+            m_number(n), m_indexes(std::move(indexes)), m_value(value) {}
+
+        Result Evaluate(Solution &s) const override {
+            return EvaluateAtMostNOf(s, m_indexes.begin(), m_indexes.end(),
+                                     m_number, m_value);
+        }
+
+        void AppendScope(IndexList &scope) const override {
+            scope.insert(scope.end(), m_indexes.begin(), m_indexes.end());
+        }
+
+        bool Flatten(FlatModelBuilder &model) const override {
+            model.Begin(ConstraintKind::AT_MOST_N_OF, m_value, m_number);
+            model.Append(m_indexes.begin(), m_indexes.end());
+            return true;
         }
 
     private:
@@ -121,38 +166,22 @@ class IfPThenOneOrMoreOfQ : public Puzzle::BasicConstraint {
             BasicConstraint(name), m_p(P), m_q(std::move(Q)) {}
 
         Result Evaluate(Solution &s) const override {
-            auto const P = s[m_p];
-            auto const Q = QCount(s);
-            if (P == YES) {
-                if (Q.yeses == 0) {
-                    if (Q.maybes == 0) return Result::CONFLICT;
-                    if (Q.maybes == 1) {
-                        for (auto i : m_q) {
-                            if (s[i] == MAYBE) return s.Set(i, YES);
-                        }
-                        assert(false && "couldn't find the one MAYBE");
-                    }
-                }
-            }
-            if (P == MAYBE && Q.yeses == 0 && Q.maybes == 0) {
-                return s.Set(m_p, NO);
-            }
-            return Result::NO_CHANGE;
+            return EvaluateIfPThenOneOrMoreOfQ(s, m_p, m_q.begin(), m_q.end());
         }
 
-    private:
-        struct Counts { std::size_t noes = 0, maybes = 0, yeses = 0; };
-        Counts QCount(Solution const &s) const {
-            Counts counts;
-            for (auto const i : m_q) {
-                switch (s[i]) {
-                    case YES:   counts.yeses  += 1; break;
-                    case MAYBE: counts.maybes += 1; break;
-                    case NO:    counts.noes   += 1; break;
-                }
-            }
-            return counts;
+        void AppendScope(IndexList &scope) const override {
+            scope.push_back(m_p);
+            scope.insert(scope.end(), m_q.begin(), m_q.end());
         }
+
+        bool Flatten(FlatModelBuilder &model) const override {
+            model.Begin(ConstraintKind::IF_P_THEN_ONE_OR_MORE_OF_Q);
+            model.Append(m_p);
+            model.Append(m_q.begin(), m_q.end());
+            return true;
+        }
+
+    private:
         Index m_p;
         IndexList m_q;
 };
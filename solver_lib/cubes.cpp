@@ -0,0 +1,265 @@
+#include "cubes.h"
+
+#include <istream>
+#include <ostream>
+#include <string>
+
+namespace {
+
+std::size_t CountDecided(const Solution &s) {
+    std::size_t count = 0;
+    for (Index i = 0; i < s.size(); ++i) {
+        if (s[i] != MAYBE) ++count;
+    }
+    return count;
+}
+
+// Up to limit MAYBEs, spread evenly through the slots.
+IndexList SampleMaybes(const Solution &s, std::size_t limit) {
+    IndexList maybes;
+    for (Index i = 0; i < s.size(); ++i) {
+        if (s[i] == MAYBE) maybes.push_back(i);
+    }
+    if (maybes.size() <= limit) return maybes;
+    IndexList sample;
+    for (std::size_t k = 0; k < limit; ++k) {
+        sample.push_back(maybes[k * maybes.size() / limit]);
+    }
+    return sample;
+}
+
+// Returns the number of slots that setting the literal decides, counting
+// the literal itself, or 0 if it leads to a conflict.
+std::size_t Probe(const Puzzle &puzzle, const Solution &node, Literal literal,
+                  const SolveOptions &quiet) {
+    Solution trial = node;  // copy
+    trial.Set(literal.index, literal.value);
+    if (puzzle.Propagate(trial, quiet) == Result::CONFLICT) return 0;
+    return CountDecided(trial) - CountDecided(node);
+}
+
+void Split(const Puzzle &puzzle, Solution node, Cube &cube, std::size_t depth,
+           const SplitOptions &options, std::vector<Cube> &cubes) {
+    SolveOptions quiet;
+    quiet.trace = false;
+    const std::size_t assumed = cube.size();
+    for (;;) {
+        if (puzzle.Propagate(node, quiet) == Result::CONFLICT) break;
+        if (depth == 0) {
+            cubes.push_back(cube);
+            break;
+        }
+
+        Index best = node.size();
+        std::size_t best_score = 0;
+        bool forced = false;
+        for (const Index slot : SampleMaybes(node, options.lookahead)) {
+            if (node[slot] != MAYBE) continue;
+            const std::size_t yes = Probe(puzzle, node, Literal{slot, YES}, quiet);
+            const std::size_t no = Probe(puzzle, node, Literal{slot, NO}, quiet);
+            if (yes == 0 || no == 0) {
+                if (yes == 0 && no == 0) {
+                    // Neither value works, so the cube has no solutions.
+                    cube.resize(assumed);
+                    return;
+                }
+                const Literal implied{slot, yes == 0 ? NO : YES};
+                node.Set(implied.index, implied.value);
+                cube.push_back(implied);
+                forced = true;
+                continue;
+            }
+            // Favor splits that decide a lot on both sides.
+            const std::size_t score = yes * no;
+            if (score > best_score) {
+                best = slot;
+                best_score = score;
+            }
+        }
+        if (forced) continue;  // propagate what the failed probes implied
+        if (best == node.size()) {
+            // Nothing left to split on, so this is a solution.
+            cubes.push_back(cube);
+            break;
+        }
+        for (const Truth value : {YES, NO}) {
+            Solution branch = node;  // copy
+            branch.Set(best, value);
+            cube.push_back(Literal{best, value});
+            Split(puzzle, std::move(branch), cube, depth - 1, options, cubes);
+            cube.pop_back();
+        }
+        break;
+    }
+    cube.resize(assumed);
+}
+
+long long ToDimacs(Literal literal) {
+    const auto k = static_cast<long long>(literal.index) + 1;
+    return literal.value == YES ? k : -k;
+}
+
+const char *StatusName(CubeStatus status) {
+    switch (status) {
+        case CubeStatus::SATISFIABLE:   return "sat";
+        case CubeStatus::UNSATISFIABLE: return "unsat";
+        case CubeStatus::UNKNOWN:       return "unknown";
+    }
+    return "unknown";
+}
+
+}
+
+std::vector<Cube> SplitIntoCubes(const Puzzle &puzzle,
+                                 const SplitOptions &options) {
+    std::size_t depth = 0;
+    while ((std::size_t{1} << depth) < options.cubes) ++depth;
+    std::vector<Cube> cubes;
+    Cube cube;
+    Split(puzzle, Solution(puzzle.SlotCount()), cube, depth, options, cubes);
+    return cubes;
+}
+
+void WriteCubes(std::ostream &out, std::size_t slots,
+                const std::vector<Cube> &cubes) {
+    out << "p cubes " << slots << ' ' << cubes.size() << '\n';
+    for (const auto &cube : cubes) {
+        out << 'a';
+        for (const auto &literal : cube) out << ' ' << ToDimacs(literal);
+        out << " 0\n";
+    }
+}
+
+bool ReadCubes(std::istream &in, std::size_t &slots, std::vector<Cube> &cubes) {
+    std::string p, kind;
+    std::size_t count = 0;
+    if (!(in >> p >> kind >> slots >> count) || p != "p" || kind != "cubes") {
+        return false;
+    }
+    cubes.clear();
+    std::string a;
+    while (cubes.size() < count && in >> a) {
+        if (a != "a") return false;
+        Cube cube;
+        long long k = 0;
+        while (in >> k && k != 0) {
+            // Negating LLONG_MIN would overflow, and a huge k would wrap
+            // around as an Index, so check the magnitude unsigned first.
+            const auto magnitude = k < 0 ? 0 - static_cast<unsigned long long>(k)
+                                         : static_cast<unsigned long long>(k);
+            if (magnitude > slots) return false;
+            const auto index = static_cast<Index>(magnitude - 1);
+            cube.push_back(Literal{index, k < 0 ? NO : YES});
+        }
+        if (!in) return false;
+        cubes.push_back(std::move(cube));
+    }
+    return cubes.size() == count;
+}
+
+CubeResult SolveCube(const Puzzle &puzzle, const Cube &cube,
+                     std::size_t number, SolveOptions options) {
+    options.solution_limit = 1;
+    SolveStatistics stats;
+    const auto solutions = puzzle.Solve(cube, options, &stats);
+    CubeResult result;
+    result.cube = number;
+    result.nodes = stats.nodes;
+    if (!solutions.empty()) {
+        result.status = CubeStatus::SATISFIABLE;
+        const Solution &s = solutions.front();
+        for (Index i = 0; i < s.size(); ++i) {
+            if (s[i] == YES) result.yes.push_back(i);
+        }
+    } else if (!stats.gave_up && !stats.cancelled) {
+        result.status = CubeStatus::UNSATISFIABLE;
+    }
+    return result;
+}
+
+void WriteResultsHeader(std::ostream &out, std::size_t slots,
+                        std::size_t cubes) {
+    out << "p results " << slots << ' ' << cubes << '\n';
+}
+
+void WriteResult(std::ostream &out, const CubeResult &result) {
+    out << "r " << result.cube << ' ' << StatusName(result.status) << ' '
+        << result.nodes << '\n';
+    if (result.status == CubeStatus::SATISFIABLE) {
+        out << 'v';
+        for (const Index i : result.yes) out << ' ' << i + 1;
+        out << " 0\n";
+    }
+    out.flush();
+}
+
+bool ReadResults(std::istream &in, std::size_t &slots, std::size_t &cubes,
+                 std::vector<CubeResult> &results) {
+    std::string p, kind;
+    std::size_t file_slots = 0, file_cubes = 0;
+    if (!(in >> p >> kind >> file_slots >> file_cubes) ||
+        p != "p" || kind != "results") {
+        return false;
+    }
+    if (slots == 0 && cubes == 0) {
+        slots = file_slots;
+        cubes = file_cubes;
+    }
+    if (file_slots != slots || file_cubes != cubes) return false;
+
+    std::string tag, status;
+    while (in >> tag) {
+        if (tag != "r") return false;
+        CubeResult result;
+        if (!(in >> result.cube >> status >> result.nodes)) return false;
+        if (result.cube >= cubes) return false;
+        if (status == "sat") {
+            result.status = CubeStatus::SATISFIABLE;
+            std::string v;
+            std::size_t k = 0;
+            if (!(in >> v) || v != "v") return false;
+            while (in >> k && k != 0) {
+                if (k > slots) return false;
+                result.yes.push_back(k - 1);
+            }
+            if (!in) return false;
+        } else if (status == "unsat") {
+            result.status = CubeStatus::UNSATISFIABLE;
+        } else if (status != "unknown") {
+            return false;
+        }
+        results.push_back(std::move(result));
+    }
+    return in.eof();
+}
+
+MergedResult MergeResults(std::size_t cubes,
+                          const std::vector<CubeResult> &results) {
+    // A cube may have been attempted more than once, say with a higher node
+    // limit after giving up, so any known status wins over UNKNOWN.
+    std::vector<const CubeResult *> best(cubes, nullptr);
+    MergedResult merged;
+    for (const auto &result : results) {
+        merged.nodes += result.nodes;
+        const CubeResult *&b = best[result.cube];
+        if (b == nullptr || b->status == CubeStatus::UNKNOWN) b = &result;
+    }
+    bool all_unsatisfiable = true;
+    for (const CubeResult *b : best) {
+        if (b == nullptr || b->status == CubeStatus::UNKNOWN) {
+            ++merged.missing;
+            all_unsatisfiable = false;
+            continue;
+        }
+        ++merged.solved;
+        if (b->status == CubeStatus::SATISFIABLE) {
+            all_unsatisfiable = false;
+            if (merged.status != CubeStatus::SATISFIABLE) {
+                merged.status = CubeStatus::SATISFIABLE;
+                merged.yes = b->yes;
+            }
+        }
+    }
+    if (all_unsatisfiable) merged.status = CubeStatus::UNSATISFIABLE;
+    return merged;
+}
@@ -0,0 +1,83 @@
+// Cube and conquer:  splitting a puzzle into independent subproblems that
+// separate processes (or machines) can solve, and merging their results.
+//
+// A cube is a list of literals assumed true.  The cubes from SplitIntoCubes
+// cover every solution of the puzzle, so the puzzle is solvable exactly when
+// some cube is.  Cube files are text in the format of the march_cu splitter:
+//
+//   p cubes <slots> <count>
+//   a 4 -17 250 0
+//
+// where literal k means slot k-1 is YES and -k means it's NO.  Result files
+// record the outcome of each cube a worker solved:
+//
+//   p results <slots> <count>
+//   r <cube> sat <nodes>
+//   v <slots that are YES, plus one> 0
+//   r <cube> unsat <nodes>
+//   r <cube> unknown <nodes>
+#ifndef CUBES_H
+#define CUBES_H
+
+#include "solver_lib/solver.h"
+
+#include <iosfwd>
+#include <vector>
+
+using Cube = std::vector<Literal>;
+
+struct SplitOptions {
+    // Split until there are about this many cubes.
+    std::size_t cubes = 64;
+    // Look ahead at no more than this many MAYBEs when choosing each split.
+    std::size_t lookahead = 64;
+};
+
+// Splits the puzzle by looking ahead:  it tries both values of a sample of
+// MAYBEs and splits on the one whose two branches fix the most slots.  A
+// value that conflicts is ruled out, and its opposite is added to the cube.
+std::vector<Cube> SplitIntoCubes(const Puzzle &puzzle,
+                                 const SplitOptions &options = {});
+
+void WriteCubes(std::ostream &out, std::size_t slots,
+                const std::vector<Cube> &cubes);
+// Returns false if the input isn't a cube file.
+bool ReadCubes(std::istream &in, std::size_t &slots, std::vector<Cube> &cubes);
+
+enum class CubeStatus { SATISFIABLE, UNSATISFIABLE, UNKNOWN };
+
+struct CubeResult {
+    std::size_t cube = 0;
+    CubeStatus status = CubeStatus::UNKNOWN;
+    std::size_t nodes = 0;
+    IndexList yes;      // with SATISFIABLE, the YES slots of a solution
+};
+
+// Finds a solution under the cube's assumptions.  The result is UNKNOWN if
+// the search gave up at the node limit or was cancelled.
+CubeResult SolveCube(const Puzzle &puzzle, const Cube &cube,
+                     std::size_t number, SolveOptions options);
+
+void WriteResultsHeader(std::ostream &out, std::size_t slots,
+                        std::size_t cubes);
+void WriteResult(std::ostream &out, const CubeResult &result);
+// Appends the results in the input.  Returns false if it isn't a results
+// file or doesn't match the given slots and number of cubes (which the
+// first file read sets if they're zero).
+bool ReadResults(std::istream &in, std::size_t &slots, std::size_t &cubes,
+                 std::vector<CubeResult> &results);
+
+struct MergedResult {
+    // SATISFIABLE if any cube was, UNSATISFIABLE if every cube was, and
+    // otherwise UNKNOWN.
+    CubeStatus status = CubeStatus::UNKNOWN;
+    std::size_t solved = 0;     // cubes with a known status
+    std::size_t missing = 0;    // cubes with no result, or only UNKNOWN
+    std::size_t nodes = 0;
+    IndexList yes;              // from the first satisfiable cube
+};
+
+MergedResult MergeResults(std::size_t cubes,
+                          const std::vector<CubeResult> &results);
+
+#endif
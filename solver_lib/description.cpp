@@ -0,0 +1,236 @@
+#include "description.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <functional>
+#include <istream>
+#include <map>
+#include <optional>
+#include <string_view>
+
+namespace {
+
+using Names = std::map<std::string, std::size_t, std::less<>>;
+
+// Splits a line into words, dropping the comment.  Returns false if a quote
+// isn't closed.
+bool SplitWords(const std::string &line, std::vector<std::string_view> &words) {
+    words.clear();
+    std::size_t i = 0;
+    while (i < line.size() && line[i] != '#') {
+        const char c = line[i];
+        if (c == ' ' || c == '\t' || c == '\r') {
+            ++i;
+        } else if (c == '"') {
+            const std::size_t close = line.find('"', i + 1);
+            if (close == std::string::npos) return false;
+            words.emplace_back(line.data() + i + 1, close - i - 1);
+            i = close + 1;
+        } else {
+            const std::size_t end = std::min(line.find_first_of(" \t\r\"#", i),
+                                             line.size());
+            words.emplace_back(line.data() + i, end - i);
+            i = end;
+        }
+    }
+    return true;
+}
+
+std::string Quoted(std::string_view name) {
+    return "\"" + std::string(name) + "\"";
+}
+
+class Reader {
+    public:
+        explicit Reader(GridDescription &description) : m_d(description) {}
+
+        // Each returns an empty string if all is well, and otherwise what's
+        // wrong.
+        std::string Line(const std::vector<std::string_view> &words);
+        std::string Finish();
+
+    private:
+        std::string Positions(const std::vector<std::string_view> &words);
+        std::string Category(const std::vector<std::string_view> &words);
+        std::string Clue(const std::vector<std::string_view> &words);
+        // The rules of every logic grid, once the categories are known.
+        void AddRules();
+
+        void AppendRow(std::size_t item) {
+            for (std::size_t p = 0; p < m_d.positions.size(); ++p) {
+                m_model->Append(m_d.IndexOf(p, item));
+            }
+        }
+
+        void AppendNeighbors(std::size_t p, std::size_t item) {
+            if (0 < p) m_model->Append(m_d.IndexOf(p - 1, item));
+            if (p + 1 < m_d.positions.size()) {
+                m_model->Append(m_d.IndexOf(p + 1, item));
+            }
+        }
+
+        GridDescription &m_d;
+        Names m_positions;
+        Names m_items;
+        // Created when the first clue arrives, since the slot count depends
+        // on all the categories.
+        std::optional<FlatModelBuilder> m_model;
+};
+
+std::string Reader::Line(const std::vector<std::string_view> &words) {
+    if (words.empty()) return {};
+    if (words[0] == "positions") return Positions(words);
+    if (words[0] == "category") return Category(words);
+    return Clue(words);
+}
+
+std::string Reader::Positions(const std::vector<std::string_view> &words) {
+    if (!m_d.positions.empty()) return "The positions were already given.";
+    if (words.size() < 2) return "No positions.";
+    if (words.size() == 2 && !words[1].empty() &&
+        words[1].find_first_not_of("0123456789") == std::string_view::npos) {
+        const std::size_t count = std::strtoull(std::string(words[1]).c_str(),
+                                                nullptr, 10);
+        if (count == 0) return "No positions.";
+        for (std::size_t p = 0; p < count; ++p) {
+            m_d.positions.push_back(std::to_string(p + 1));
+        }
+    } else {
+        m_d.positions.assign(words.begin() + 1, words.end());
+    }
+    for (std::size_t p = 0; p < m_d.positions.size(); ++p) {
+        if (!m_positions.emplace(m_d.positions[p], p).second) {
+            return "Position " + Quoted(m_d.positions[p]) + " appears twice.";
+        }
+    }
+    return {};
+}
+
+std::string Reader::Category(const std::vector<std::string_view> &words) {
+    if (m_d.positions.empty()) return "The positions must come first.";
+    if (m_model) return "The categories must come before the clues.";
+    if (words.size() != m_d.positions.size() + 2) {
+        return "A category needs a name and " +
+               std::to_string(m_d.positions.size()) + " items.";
+    }
+    m_d.categories.emplace_back(words[1]);
+    for (std::size_t k = 2; k < words.size(); ++k) {
+        if (!m_items.emplace(std::string(words[k]), m_d.items.size()).second) {
+            return "Item " + Quoted(words[k]) + " appears twice.";
+        }
+        m_d.items.emplace_back(words[k]);
+    }
+    return {};
+}
+
+std::string Reader::Clue(const std::vector<std::string_view> &words) {
+    const std::string_view type = words[0];
+    const bool between_items = type == "same" || type == "not-same" ||
+                               type == "next-to" || type == "right-of";
+    const bool at_position = type == "at" || type == "not-at";
+    if (!between_items && !at_position) {
+        return "Unknown clue " + Quoted(type) + '.';
+    }
+    if (m_d.categories.empty()) return "The categories must come first.";
+    if (words.size() != 3) return "The clue " + Quoted(type) + " takes two names.";
+    if (!m_model) AddRules();
+
+    const auto a_found = m_items.find(words[1]);
+    if (a_found == m_items.end()) return "Unknown item " + Quoted(words[1]) + '.';
+    const std::size_t a = a_found->second;
+    const std::size_t last = m_d.positions.size() - 1;
+    if (at_position) {
+        const auto p = m_positions.find(words[2]);
+        if (p == m_positions.end()) {
+            return "Unknown position " + Quoted(words[2]) + '.';
+        }
+        m_model->Begin(ConstraintKind::FIXED, type == "at" ? YES : NO);
+        m_model->Append(m_d.IndexOf(p->second, a));
+        return {};
+    }
+
+    const auto b_found = m_items.find(words[2]);
+    if (b_found == m_items.end()) return "Unknown item " + Quoted(words[2]) + '.';
+    const std::size_t b = b_found->second;
+    if (type == "same") {
+        m_model->Begin(ConstraintKind::IDENTICAL);
+        AppendRow(a);
+        AppendRow(b);
+    } else if (type == "not-same") {
+        for (std::size_t p = 0; p <= last; ++p) {
+            m_model->Begin(ConstraintKind::AT_MOST_N_OF, YES, 1);
+            m_model->Append(m_d.IndexOf(p, a));
+            m_model->Append(m_d.IndexOf(p, b));
+        }
+    } else if (type == "next-to") {
+        // In both directions, so that the solver can reason from either item.
+        for (std::size_t p = 0; p <= last; ++p) {
+            m_model->Begin(ConstraintKind::IF_P_THEN_ONE_OR_MORE_OF_Q);
+            m_model->Append(m_d.IndexOf(p, a));
+            AppendNeighbors(p, b);
+            m_model->Begin(ConstraintKind::IF_P_THEN_ONE_OR_MORE_OF_Q);
+            m_model->Append(m_d.IndexOf(p, b));
+            AppendNeighbors(p, a);
+        }
+    } else {
+        m_model->Begin(ConstraintKind::FIXED, NO);
+        m_model->Append(m_d.IndexOf(0, a));
+        m_model->Begin(ConstraintKind::FIXED, NO);
+        m_model->Append(m_d.IndexOf(last, b));
+        for (std::size_t p = 1; p <= last; ++p) {
+            m_model->Begin(ConstraintKind::IF_P_THEN_Q);
+            m_model->Append(m_d.IndexOf(p, a));
+            m_model->Append(m_d.IndexOf(p - 1, b));
+            m_model->Begin(ConstraintKind::IF_P_THEN_Q);
+            m_model->Append(m_d.IndexOf(p - 1, b));
+            m_model->Append(m_d.IndexOf(p, a));
+        }
+    }
+    return {};
+}
+
+void Reader::AddRules() {
+    const std::size_t positions = m_d.positions.size();
+    m_model.emplace(positions * m_d.items.size());
+    for (std::size_t c = 0; c < m_d.categories.size(); ++c) {
+        const std::size_t first = c * positions;
+        for (std::size_t p = 0; p < positions; ++p) {
+            m_model->Begin(ConstraintKind::EXACTLY_N_OF, YES, 1);
+            for (std::size_t item = first; item < first + positions; ++item) {
+                m_model->Append(m_d.IndexOf(p, item));
+            }
+        }
+        for (std::size_t item = first; item < first + positions; ++item) {
+            m_model->Begin(ConstraintKind::EXACTLY_N_OF, YES, 1);
+            AppendRow(item);
+        }
+    }
+}
+
+std::string Reader::Finish() {
+    if (m_d.categories.empty()) return "No categories.";
+    if (!m_model) AddRules();
+    m_d.model = m_model->Build();
+    if (!m_d.model) return "The puzzle is too big.";
+    return {};
+}
+
+}
+
+bool ReadDescription(std::istream &in, GridDescription &description,
+                     std::string &error) {
+    description = GridDescription{};
+    Reader reader(description);
+    std::string line;
+    std::vector<std::string_view> words;
+    for (std::size_t number = 1; std::getline(in, line); ++number) {
+        error = SplitWords(line, words) ? reader.Line(words)
+                                        : "A quote isn't closed.";
+        if (!error.empty()) {
+            error = "Line " + std::to_string(number) + ": " + error;
+            return false;
+        }
+    }
+    error = reader.Finish();
+    return error.empty();
+}
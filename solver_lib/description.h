@@ -0,0 +1,59 @@
+// Logic grid puzzles described in text, so that a new puzzle is a file
+// rather than a program.  The Zebra puzzle starts like this:
+//
+//   # Five houses, each with one item of each category.
+//   positions first second middle fourth last
+//   category nationality Englishman Japanese Norwegian Spaniard Ukrainian
+//   category color blue green ivory red yellow
+//   ...
+//   same Englishman red
+//   right-of green ivory
+//   at milk middle
+//   next-to Chesterfields fox
+//
+// "positions" names the positions, or gives their number ("positions 5"
+// names them 1 to 5).  Each category lists its items, one per position, and
+// item names must be unique across categories.  Names that contain spaces
+// go in double quotes.  After the categories come the clues:
+//
+//   same A B        A and B are at the same position
+//   not-same A B    A and B are at different positions
+//   at A P          A is at position P
+//   not-at A P      A is not at position P
+//   next-to A B     A is immediately to the left or right of B
+//   right-of A B    A is immediately to the right of B
+//
+// Everything after a # is a comment.
+#ifndef DESCRIPTION_H
+#define DESCRIPTION_H
+
+#include "solver_lib/flat_model.h"
+#include "solver_lib/solver.h"
+
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Like zebra.cpp, a solution has one Truth value for every item at every
+// position.  The items of category c are items[c*P] to items[c*P + P - 1],
+// where P is the number of positions.
+struct GridDescription {
+    std::vector<std::string> positions;
+    std::vector<std::string> categories;
+    std::vector<std::string> items;
+    // The rules that every logic grid has, followed by the clues.
+    std::shared_ptr<const FlatModel> model;
+
+    Index IndexOf(std::size_t position, std::size_t item) const {
+        return position * items.size() + item;
+    }
+};
+
+// Reads a description a line at a time, adding constraints straight to a
+// flat model as it goes.  Returns false if the input isn't a valid
+// description, and then error says why and on which line.
+bool ReadDescription(std::istream &in, GridDescription &description,
+                     std::string &error);
+
+#endif
@@ -0,0 +1,200 @@
+#include "flat_model.h"
+#include "kernels.h"
+#include "mapped_file.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+
+namespace {
+
+constexpr char magic[4] = {'P', 'Z', 'F', 'M'};
+constexpr std::uint32_t version = 1;
+constexpr std::uint32_t most = std::numeric_limits<std::uint32_t>::max();
+
+struct Header {
+    char magic[4];
+    std::uint32_t version;
+    std::uint64_t slots;
+    std::uint64_t constraints;
+    std::uint64_t indexes;
+};
+
+static_assert(sizeof(Header) == 32);
+static_assert(sizeof(FlatConstraint) == 24);
+static_assert(std::endian::native == std::endian::little,
+              "flat models are stored little-endian");
+
+bool WellFormed(const FlatConstraint &k, const std::uint32_t *indexes,
+                std::uint64_t index_count, std::uint64_t slots) {
+    if (k.value != YES && k.value != NO) return false;
+    if (k.first > index_count || k.count > index_count - k.first) return false;
+    switch (static_cast<ConstraintKind>(k.kind)) {
+        case ConstraintKind::FIXED:
+            if (k.count != 1) return false;
+            break;
+        case ConstraintKind::IF_P_THEN_Q:
+            if (k.count != 2) return false;
+            break;
+        case ConstraintKind::IDENTICAL:
+            if (k.count % 2 != 0) return false;
+            break;
+        case ConstraintKind::EXACTLY_N_OF:
+        case ConstraintKind::AT_MOST_N_OF:
+            break;
+        case ConstraintKind::IF_P_THEN_ONE_OR_MORE_OF_Q:
+            if (k.count == 0) return false;
+            break;
+        default:
+            return false;
+    }
+    for (std::uint64_t i = k.first; i < k.first + k.count; ++i) {
+        if (indexes[i] >= slots) return false;
+    }
+    return true;
+}
+
+}
+
+void FlatModelBuilder::Begin(ConstraintKind kind, Truth value,
+                             std::size_t number) {
+    // A number too big to store can't be met by any scope that fits in
+    // memory, and neither can the biggest one that can be stored.
+    m_constraints.push_back(FlatConstraint{
+        static_cast<std::uint32_t>(kind), static_cast<std::int32_t>(value),
+        static_cast<std::uint32_t>(std::min<std::size_t>(number, most)),
+        0, m_indexes.size()});
+}
+
+void FlatModelBuilder::Append(Index index) {
+    // An index too big to store is outside the puzzle, so Build rejects it.
+    m_indexes.push_back(static_cast<std::uint32_t>(std::min<Index>(index, most)));
+    ++m_constraints.back().count;
+}
+
+void FlatModelBuilder::Append(const FlatModel &model) {
+    for (std::size_t c = 0; c < model.ConstraintCount(); ++c) {
+        const FlatConstraint &k = model.Constraint(c);
+        Begin(static_cast<ConstraintKind>(k.kind), static_cast<Truth>(k.value),
+              k.number);
+        Append(model.Scope(c), model.Scope(c) + k.count);
+    }
+}
+
+std::shared_ptr<const FlatModel> FlatModelBuilder::Build() {
+    const Header header{{magic[0], magic[1], magic[2], magic[3]}, version,
+                        m_slot_count, m_constraints.size(), m_indexes.size()};
+    const std::size_t constraint_bytes = m_constraints.size() * sizeof(FlatConstraint);
+    const std::size_t index_bytes = m_indexes.size() * sizeof(std::uint32_t);
+    const std::size_t size = sizeof header + constraint_bytes + index_bytes;
+
+    std::shared_ptr<FlatModel> model(new FlatModel);
+    model->m_image.resize((size + 7) / 8);
+    auto *bytes = reinterpret_cast<char *>(model->m_image.data());
+    std::memcpy(bytes, &header, sizeof header);
+    std::memcpy(bytes + sizeof header, m_constraints.data(), constraint_bytes);
+    std::memcpy(bytes + sizeof header + constraint_bytes, m_indexes.data(),
+                index_bytes);
+    if (!model->Attach(bytes, size)) return nullptr;
+    m_constraints.clear();
+    m_indexes.clear();
+    return model;
+}
+
+FlatModel::~FlatModel() = default;
+
+std::shared_ptr<const FlatModel> FlatModel::Open(const std::string &path) {
+    std::shared_ptr<FlatModel> model(new FlatModel);
+    model->m_mapping = std::make_unique<MappedFile>();
+    if (!model->m_mapping->Open(path) ||
+        !model->Attach(model->m_mapping->Data(), model->m_mapping->Size())) {
+        return nullptr;
+    }
+    return model;
+}
+
+bool FlatModel::Attach(const void *data, std::size_t size) {
+    if (size < sizeof(Header)) return false;
+    Header header;
+    std::memcpy(&header, data, sizeof header);
+    if (!std::equal(header.magic, header.magic + sizeof magic, magic) ||
+        header.version != version || header.slots > most) {
+        return false;
+    }
+    const std::uint64_t room = size - sizeof header;
+    if (header.constraints > room / sizeof(FlatConstraint)) return false;
+    const std::uint64_t rest = room - header.constraints * sizeof(FlatConstraint);
+    if (header.indexes > rest / sizeof(std::uint32_t) ||
+        rest - header.indexes * sizeof(std::uint32_t) >= 8) {
+        return false;
+    }
+
+    const auto *bytes = static_cast<const char *>(data);
+    const auto *constraints =
+        reinterpret_cast<const FlatConstraint *>(bytes + sizeof header);
+    const auto *indexes = reinterpret_cast<const std::uint32_t *>(
+        bytes + sizeof header + header.constraints * sizeof(FlatConstraint));
+    for (std::uint64_t c = 0; c < header.constraints; ++c) {
+        if (!WellFormed(constraints[c], indexes, header.indexes, header.slots)) {
+            return false;
+        }
+    }
+    m_slot_count = static_cast<std::size_t>(header.slots);
+    m_constraint_count = static_cast<std::size_t>(header.constraints);
+    m_constraints = constraints;
+    m_indexes = indexes;
+    m_data = data;
+    m_size = size;
+    return true;
+}
+
+bool FlatModel::Save(const std::string &path) const {
+    const std::string temporary = path + ".tmp";
+    {
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+        out.write(static_cast<const char *>(m_data),
+                  static_cast<std::streamsize>(m_size));
+        out.flush();
+        if (!out) return false;
+    }
+    std::error_code error;
+    std::filesystem::rename(temporary, path, error);
+    return !error;
+}
+
+Result FlatModel::Evaluate(std::size_t c, Solution &s) const {
+    const FlatConstraint &k = m_constraints[c];
+    const std::uint32_t *scope = m_indexes + k.first;
+    const auto value = static_cast<Truth>(k.value);
+    switch (static_cast<ConstraintKind>(k.kind)) {
+        case ConstraintKind::FIXED:
+            return EvaluateFixed(s, scope[0], value);
+        case ConstraintKind::IF_P_THEN_Q:
+            return EvaluateIfPThenQ(s, scope[0], scope[1]);
+        case ConstraintKind::IDENTICAL:
+            return EvaluateIdentical(s, scope, scope + k.count / 2, k.count / 2);
+        case ConstraintKind::EXACTLY_N_OF:
+            return EvaluateExactlyNOf(s, scope, scope + k.count, k.number, value);
+        case ConstraintKind::AT_MOST_N_OF:
+            return EvaluateAtMostNOf(s, scope, scope + k.count, k.number, value);
+        case ConstraintKind::IF_P_THEN_ONE_OR_MORE_OF_Q:
+            return EvaluateIfPThenOneOrMoreOfQ(s, scope[0], scope + 1,
+                                               scope + k.count);
+    }
+    return Result::NO_CHANGE;
+}
+
+void FlatModel::AppendScope(std::size_t c, IndexList &scope) const {
+    scope.insert(scope.end(), Scope(c), Scope(c) + m_constraints[c].count);
+}
+
+const std::string &FlatModel::Name(std::size_t c) const {
+    static const std::string names[] = {
+        "", "Fixed", "IfPThenQ", "Identical", "ExactlyNOf", "AtMostNOf",
+        "IfPThenOneOrMoreOfQ"
+    };
+    return names[m_constraints[c].kind];
+}
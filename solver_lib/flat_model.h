@@ -0,0 +1,121 @@
+// Compiled puzzles in a flat binary form that can be mapped into memory and
+// used as is, without building a constraint object for each constraint.
+#ifndef FLAT_MODEL_H
+#define FLAT_MODEL_H
+
+#include "solver_lib/solver.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// The built-in constraints of constraints.h.
+enum class ConstraintKind : std::uint32_t {
+    FIXED = 1,                    // scope: the index
+    IF_P_THEN_Q,                  // scope: P, Q
+    IDENTICAL,                    // scope: the first list, then the second
+    EXACTLY_N_OF,
+    AT_MOST_N_OF,
+    IF_P_THEN_ONE_OR_MORE_OF_Q    // scope: P, then Q
+};
+
+// One constraint.  Its scope is indexes [first, first + count) of the
+// model's index array.  The value is YES or NO, and the number is the n of
+// ExactlyNOf and AtMostNOf.
+struct FlatConstraint {
+    std::uint32_t kind;
+    std::int32_t value;
+    std::uint32_t number;
+    std::uint32_t count;
+    std::uint64_t first;
+};
+
+class FlatModel;
+class MappedFile;
+
+// Collects constraints into the flat form, one at a time.
+class FlatModelBuilder {
+    public:
+        explicit FlatModelBuilder(std::size_t slots) : m_slot_count(slots) {}
+
+        std::size_t SlotCount() const { return m_slot_count; }
+        std::size_t ConstraintCount() const { return m_constraints.size(); }
+
+        // Starts a constraint.  Its scope is what's appended until the next.
+        void Begin(ConstraintKind kind, Truth value = YES, std::size_t number = 0);
+        void Append(Index index);
+        template <typename It>
+        void Append(It begin, It end) {
+            for (It it = begin; it != end; ++it) Append(static_cast<Index>(*it));
+        }
+
+        // Appends the constraints of a model.
+        void Append(const FlatModel &model);
+
+        // Returns null if a constraint is malformed, for instance with an
+        // index outside the puzzle or a scope of the wrong size for its kind.
+        std::shared_ptr<const FlatModel> Build();
+
+    private:
+        std::size_t m_slot_count;
+        std::vector<FlatConstraint> m_constraints;
+        std::vector<std::uint32_t> m_indexes;
+};
+
+// The constraints of a puzzle as arrays.  A model is either built in memory
+// or mapped read-only from a file that Save wrote.  The file is a header
+// (the magic "PZFM", a version, and the numbers of slots, constraints, and
+// indexes), then the constraints, then the indexes, all little-endian.
+// Mapping it costs nothing up front; the pages are read as the solver
+// touches them.
+class FlatModel {
+    public:
+        ~FlatModel();
+        FlatModel(const FlatModel &) = delete;
+        FlatModel &operator=(const FlatModel &) = delete;
+
+        // Returns null if the file can't be mapped or isn't a valid model.
+        static std::shared_ptr<const FlatModel> Open(const std::string &path);
+
+        // Returns false on failure.
+        bool Save(const std::string &path) const;
+
+        std::size_t SlotCount() const { return m_slot_count; }
+        std::size_t ConstraintCount() const { return m_constraint_count; }
+
+        const FlatConstraint &Constraint(std::size_t c) const { return m_constraints[c]; }
+        const std::uint32_t *Scope(std::size_t c) const {
+            return m_indexes + m_constraints[c].first;
+        }
+
+        Result Evaluate(std::size_t c, Solution &s) const;
+        void AppendScope(std::size_t c, IndexList &scope) const;
+        // The name of the constraint's kind, since the model has no names.
+        const std::string &Name(std::size_t c) const;
+
+        // The image, as Save writes it.
+        const void *Data() const { return m_data; }
+        std::size_t Size() const { return m_size; }
+
+    private:
+        friend class FlatModelBuilder;
+
+        FlatModel() = default;
+        // Points at the parts of the image and checks them.
+        bool Attach(const void *data, std::size_t size);
+
+        std::size_t m_slot_count = 0;
+        std::size_t m_constraint_count = 0;
+        const FlatConstraint *m_constraints = nullptr;
+        const std::uint32_t *m_indexes = nullptr;
+        const void *m_data = nullptr;
+        std::size_t m_size = 0;
+
+        // A model built in memory owns its image.
+        std::vector<std::uint64_t> m_image;
+        // A mapped one owns the mapping.
+        std::unique_ptr<MappedFile> m_mapping;
+};
+
+#endif
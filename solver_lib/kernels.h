@@ -0,0 +1,116 @@
+// The logic of the built-in constraints, as functions of index ranges, so
+// that the constraint classes in constraints.h and the flat models in
+// flat_model.h evaluate them the same way.
+#ifndef KERNELS_H
+#define KERNELS_H
+
+#include "solver_lib/solver.h"
+
+#include <cassert>
+#include <cstddef>
+
+template <typename It>
+std::size_t CountIn(const Solution &s, It begin, It end, Truth value) {
+    std::size_t count = 0;
+    for (It it = begin; it != end; ++it) {
+        if (s[static_cast<Index>(*it)] == value) ++count;
+    }
+    return count;
+}
+
+inline Result EvaluateFixed(Solution &s, Index index, Truth value) {
+    return s.Set(index, value);
+}
+
+inline Result EvaluateIfPThenQ(Solution &s, Index p, Index q) {
+    if (s[p] == YES && s[q] == NO) return Result::CONFLICT;
+    if (s[p] == YES && s[q] == MAYBE) return s.Set(q, YES);
+    if (s[q] == NO  && s[p] == MAYBE) return s.Set(p, NO);
+    return Result::NO_CHANGE;
+}
+
+// The values at indexes1[i] and indexes2[i] must match, for each i.
+template <typename It>
+Result EvaluateIdentical(Solution &s, It indexes1, It indexes2,
+                         std::size_t count) {
+    Result result = Result::NO_CHANGE;
+    for (std::size_t i = 0; i < count; ++i) {
+        const auto a = static_cast<Index>(indexes1[i]);
+        const auto b = static_cast<Index>(indexes2[i]);
+        if (s[a] == YES && s[b] == NO) return Result::CONFLICT;
+        if (s[b] == YES && s[a] == NO) return Result::CONFLICT;
+        if (s[a] == MAYBE && s[b] != MAYBE) {
+            s.Set(a, s[b]);
+            result = Result::PROGRESS;
+        }
+        if (s[b] == MAYBE && s[a] != MAYBE) {
+            s.Set(b, s[a]);
+            result = Result::PROGRESS;
+        }
+    }
+    return result;
+}
+
+template <typename It>
+Result EvaluateExactlyNOf(Solution &s, It begin, It end, std::size_t number,
+                          Truth value) {
+    const std::size_t matches = CountIn(s, begin, end, value);
+    const std::size_t maybes = CountIn(s, begin, end, MAYBE);
+    if (maybes < number - matches) return Result::CONFLICT;
+    if (matches > number) return Result::CONFLICT;
+    if (maybes > 0) {
+        if (matches == number) {
+            for (It it = begin; it != end; ++it) {
+                const auto index = static_cast<Index>(*it);
+                if (s[index] == MAYBE) s.Set(index, !value);
+            }
+            return Result::PROGRESS;
+        }
+        if (maybes == number - matches) {
+            for (It it = begin; it != end; ++it) {
+                const auto index = static_cast<Index>(*it);
+                if (s[index] == MAYBE) s.Set(index, value);
+            }
+            return Result::PROGRESS;
+        }
+    }
+    return Result::NO_CHANGE;
+}
+
+template <typename It>
+Result EvaluateAtMostNOf(Solution &s, It begin, It end, std::size_t number,
+                         Truth value) {
+    const std::size_t matches = CountIn(s, begin, end, value);
+    if (matches > number) return Result::CONFLICT;
+    if (matches < number) return Result::NO_CHANGE;
+    Result result = Result::NO_CHANGE;
+    for (It it = begin; it != end; ++it) {
+        const auto index = static_cast<Index>(*it);
+        if (s[index] == MAYBE) {
+            s.Set(index, !value);
+            result = Result::PROGRESS;
+        }
+    }
+    return result;
+}
+
+template <typename It>
+Result EvaluateIfPThenOneOrMoreOfQ(Solution &s, Index p, It begin, It end) {
+    const Truth P = s[p];
+    const std::size_t yeses = CountIn(s, begin, end, YES);
+    const std::size_t maybes = CountIn(s, begin, end, MAYBE);
+    if (P == YES && yeses == 0) {
+        if (maybes == 0) return Result::CONFLICT;
+        if (maybes == 1) {
+            for (It it = begin; it != end; ++it) {
+                const auto index = static_cast<Index>(*it);
+                if (s[index] == MAYBE) return s.Set(index, YES);
+            }
+            assert(false && "couldn't find the one MAYBE");
+        }
+    }
+    if (P == MAYBE && yeses == 0 && maybes == 0) return s.Set(p, NO);
+    return Result::NO_CHANGE;
+}
+
+#endif
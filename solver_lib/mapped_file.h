@@ -0,0 +1,28 @@
+// Read-only memory mappings of files, with mmap or CreateFileMapping.
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+
+class MappedFile {
+    public:
+        MappedFile() = default;
+        ~MappedFile() { Close(); }
+        MappedFile(const MappedFile &) = delete;
+        MappedFile &operator=(const MappedFile &) = delete;
+
+        // Maps the whole file, replacing any earlier mapping.  Returns false
+        // if the file can't be opened or mapped, or is empty.
+        bool Open(const std::string &path);
+        void Close();
+
+        const void *Data() const { return m_data; }
+        std::size_t Size() const { return m_size; }
+
+    private:
+        void *m_data = nullptr;
+        std::size_t m_size = 0;
+};
+
+#endif
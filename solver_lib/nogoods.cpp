@@ -0,0 +1,79 @@
+#include "nogoods.h"
+
+namespace {
+
+std::uint64_t Pack(Literal literal) {
+    return static_cast<std::uint64_t>(literal.index) * 2 +
+           (literal.value == YES ? 1 : 0);
+}
+
+Literal Unpack(std::uint64_t packed) {
+    return Literal{static_cast<Index>(packed / 2), (packed & 1) ? YES : NO};
+}
+
+}
+
+NogoodExchange::NogoodExchange(std::size_t capacity) :
+    m_capacity(capacity < 1 ? 1 : capacity),
+    m_slots(std::make_unique<Slot[]>(m_capacity)) {}
+
+bool NogoodExchange::Publish(const Literal *literals, std::size_t length,
+                             std::uint64_t source) {
+    if (length > max_length) return false;
+    const std::uint64_t ticket = m_head.fetch_add(1, std::memory_order_relaxed);
+    Slot &slot = m_slots[ticket % m_capacity];
+
+    // Claim the slot unless another writer is busy with it or has already
+    // moved past this ticket.  Losing a nogood now and then is harmless.
+    std::uint64_t current = slot.sequence.load(std::memory_order_acquire);
+    if (current % 2 == 1 || current >= 2*ticket + 1) return false;
+    if (!slot.sequence.compare_exchange_strong(current, 2*ticket + 1,
+                                               std::memory_order_acq_rel)) {
+        return false;
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.source.store(source, std::memory_order_relaxed);
+    slot.length.store(length, std::memory_order_relaxed);
+    for (std::size_t i = 0; i < length; ++i) {
+        slot.literals[i].store(Pack(literals[i]), std::memory_order_relaxed);
+    }
+    slot.sequence.store(2*ticket + 2, std::memory_order_release);
+    return true;
+}
+
+std::size_t NogoodExchange::Import(
+    std::uint64_t &cursor,
+    std::uint64_t source,
+    std::size_t max_size,
+    std::vector<std::vector<Literal>> &nogoods
+) const {
+    const std::uint64_t head = m_head.load(std::memory_order_acquire);
+    if (head - cursor > m_capacity) cursor = head - m_capacity;
+    std::size_t imported = 0;
+    for (; cursor < head; ++cursor) {
+        const Slot &slot = m_slots[cursor % m_capacity];
+        const std::uint64_t before = slot.sequence.load(std::memory_order_acquire);
+        // If it's still being written, try again next time.
+        if (before == 2*cursor + 1) break;
+        // Otherwise it was lost or has already been overwritten.
+        if (before != 2*cursor + 2) continue;
+
+        const std::uint64_t from = slot.source.load(std::memory_order_relaxed);
+        const auto length = static_cast<std::size_t>(
+            slot.length.load(std::memory_order_relaxed));
+        std::vector<Literal> nogood;
+        if (from != source && length <= max_size) {
+            for (std::size_t i = 0; i < length; ++i) {
+                nogood.push_back(
+                    Unpack(slot.literals[i].load(std::memory_order_relaxed)));
+            }
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.sequence.load(std::memory_order_relaxed) != before) continue;
+        if (!nogood.empty()) {
+            nogoods.push_back(std::move(nogood));
+            ++imported;
+        }
+    }
+    return imported;
+}
@@ -0,0 +1,53 @@
+// Sharing learned nogoods between searches running in parallel.
+#ifndef NOGOODS_H
+#define NOGOODS_H
+
+#include "solver_lib/solver.h"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// A fixed-size ring of short nogoods that concurrent searches of the same
+// puzzle publish to and import from without locking.  When the ring wraps,
+// the oldest nogoods are overwritten, so a search that falls behind just
+// misses some of them.  That's fine, since nogoods are only hints that save
+// work; a search is still correct without them.
+class NogoodExchange {
+    public:
+        static constexpr std::size_t max_length = 16;
+
+        explicit NogoodExchange(std::size_t capacity = 4096);
+
+        // Returns false if the nogood was too long or if its slot was busy.
+        // The source identifies the publisher so that it can skip its own
+        // nogoods when importing.
+        bool Publish(const Literal *literals, std::size_t length,
+                     std::uint64_t source);
+
+        // Appends the nogoods published by other sources since the cursor
+        // (which starts at 0) that have at most max_size literals, and
+        // advances the cursor.  Returns the number appended.
+        std::size_t Import(std::uint64_t &cursor, std::uint64_t source,
+                           std::size_t max_size,
+                           std::vector<std::vector<Literal>> &nogoods) const;
+
+    private:
+        // Each slot is a sequence lock.  The sequence is 2*ticket + 1 while
+        // the nogood for the ticket is being written and 2*ticket + 2 once
+        // it's complete.
+        struct Slot {
+            std::atomic<std::uint64_t> sequence{0};
+            std::atomic<std::uint64_t> source{0};
+            std::atomic<std::uint64_t> length{0};
+            std::array<std::atomic<std::uint64_t>, max_length> literals{};
+        };
+
+        std::size_t m_capacity;
+        std::unique_ptr<Slot[]> m_slots;
+        std::atomic<std::uint64_t> m_head{0};
+};
+
+#endif
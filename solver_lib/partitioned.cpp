@@ -0,0 +1,188 @@
+// Propagation with the constraints split into blocks, each on its own thread.
+#include "solver.h"
+
+#include <barrier>
+#include <thread>
+
+namespace {
+
+// A group of constraints, the slots they depend on, and a private copy of
+// the candidate to propagate them on.
+struct Block {
+    std::vector<std::size_t> constraints;
+    IndexList slots;
+    Solution local;
+    bool dirty = true;
+    Result result = Result::NO_CHANGE;
+};
+
+}
+
+Result Puzzle::PropagatePartitioned(Solution &candidate, std::size_t threads,
+                                    SolveStatistics *stats) const {
+    std::size_t culprit = 0;
+    if (threads < 2) return Fixpoint(candidate, false, stats, &culprit);
+
+    // Constraints that don't report their scopes could touch anything, so
+    // they run on this thread between rounds.
+    std::vector<IndexList> scopes(ConstraintCount());
+    std::vector<std::size_t> unscoped;
+    // The constraints that depend on slot i are users[first_user[i]] up to
+    // (but not including) users[first_user[i+1]].
+    std::vector<std::size_t> first_user(m_slot_count + 1, 0);
+    for (std::size_t c = 0; c < ConstraintCount(); ++c) {
+        AppendScope(c, scopes[c]);
+        if (scopes[c].empty()) unscoped.push_back(c);
+        for (const Index i : scopes[c]) ++first_user[i + 1];
+    }
+    for (Index i = 0; i < m_slot_count; ++i) first_user[i + 1] += first_user[i];
+    std::vector<std::size_t> users(first_user.back());
+    {
+        std::vector<std::size_t> filled(first_user.begin(), first_user.end() - 1);
+        for (std::size_t c = 0; c < ConstraintCount(); ++c) {
+            for (const Index i : scopes[c]) users[filled[i]++] = c;
+        }
+    }
+    auto const for_each_user = [&](Index i, auto &&visit) {
+        for (std::size_t k = first_user[i]; k < first_user[i + 1]; ++k) {
+            visit(users[k]);
+        }
+    };
+
+    // Visiting the constraints breadth first through the slots they share
+    // puts neighbors close together, so cutting that order into contiguous
+    // pieces gives blocks that share few slots.
+    std::vector<std::size_t> order;
+    std::vector<bool> seen(ConstraintCount(), false);
+    for (std::size_t start = 0; start < ConstraintCount(); ++start) {
+        if (seen[start] || scopes[start].empty()) continue;
+        seen[start] = true;
+        order.push_back(start);
+        for (std::size_t k = order.size() - 1; k < order.size(); ++k) {
+            for (const Index i : scopes[order[k]]) {
+                for_each_user(i, [&](std::size_t c) {
+                    if (!seen[c]) {
+                        seen[c] = true;
+                        order.push_back(c);
+                    }
+                });
+            }
+        }
+    }
+    if (order.size() < 2) return Fixpoint(candidate, false, stats, &culprit);
+    threads = std::min(threads, order.size());
+
+    std::vector<Block> blocks;
+    std::vector<std::size_t> block_of(ConstraintCount(), 0);
+    std::vector<std::size_t> stamp(m_slot_count, threads);
+    for (std::size_t b = 0; b < threads; ++b) {
+        Block block{{}, {}, candidate, true, Result::NO_CHANGE};
+        for (std::size_t k = b * order.size() / threads;
+             k < (b + 1) * order.size() / threads; ++k) {
+            const std::size_t c = order[k];
+            block.constraints.push_back(c);
+            block_of[c] = b;
+            for (const Index i : scopes[c]) {
+                if (stamp[i] != b) {
+                    stamp[i] = b;
+                    block.slots.push_back(i);
+                }
+            }
+        }
+        blocks.push_back(std::move(block));
+    }
+
+    // Each round, every dirty block catches up with the shared candidate and
+    // propagates its own constraints to a fixpoint.
+    auto const propagate_block = [&](Block &block) {
+        block.result = Result::NO_CHANGE;
+        if (!block.dirty) return;
+        for (const Index i : block.slots) {
+            if (candidate[i] != MAYBE) block.local.Set(i, candidate[i]);
+        }
+        Result pass;
+        do {
+            pass = Result::NO_CHANGE;
+            for (const std::size_t c : block.constraints) {
+                const Result r = Evaluate(c, block.local);
+                if (r == Result::CONFLICT) {
+                    block.result = Result::CONFLICT;
+                    return;
+                }
+                if (r == Result::PROGRESS) pass = Result::PROGRESS;
+            }
+        } while (pass == Result::PROGRESS);
+    };
+
+    bool finished = false;
+    std::barrier sync(static_cast<std::ptrdiff_t>(threads));
+    std::vector<std::thread> pool;
+    for (std::size_t b = 1; b < threads; ++b) {
+        pool.emplace_back([&, b]() {
+            for (;;) {
+                sync.arrive_and_wait();
+                if (finished) return;
+                propagate_block(blocks[b]);
+                sync.arrive_and_wait();
+            }
+        });
+    }
+
+    Result overall = Result::NO_CHANGE;
+    for (;;) {
+        sync.arrive_and_wait();
+        propagate_block(blocks[0]);
+        sync.arrive_and_wait();
+        if (stats != nullptr) ++stats->passes;
+
+        // Merge what the blocks found, and wake up the blocks that depend on
+        // the slots that another block changed.
+        Result round = Result::NO_CHANGE;
+        for (std::size_t b = 0; b < threads && round != Result::CONFLICT; ++b) {
+            Block &block = blocks[b];
+            if (block.result == Result::CONFLICT) round = Result::CONFLICT;
+            block.dirty = false;
+        }
+        for (std::size_t b = 0; b < threads && round != Result::CONFLICT; ++b) {
+            for (const Index i : blocks[b].slots) {
+                const Truth value = blocks[b].local[i];
+                if (value == MAYBE || candidate[i] == value) continue;
+                if (candidate.Set(i, value) == Result::CONFLICT) {
+                    round = Result::CONFLICT;
+                    break;
+                }
+                round = Result::PROGRESS;
+                for_each_user(i, [&](std::size_t c) {
+                    if (block_of[c] != b) blocks[block_of[c]].dirty = true;
+                });
+            }
+        }
+        if (round != Result::CONFLICT && !unscoped.empty()) {
+            for (const std::size_t c : unscoped) {
+                const Result r = Evaluate(c, candidate);
+                if (r == Result::CONFLICT) {
+                    round = Result::CONFLICT;
+                    break;
+                }
+                if (r == Result::PROGRESS) {
+                    round = Result::PROGRESS;
+                    for (auto &block : blocks) block.dirty = true;
+                }
+            }
+        }
+
+        if (round == Result::CONFLICT) {
+            overall = Result::CONFLICT;
+            break;
+        }
+        if (round == Result::PROGRESS) overall = Result::PROGRESS;
+        bool any_dirty = false;
+        for (const auto &block : blocks) any_dirty = any_dirty || block.dirty;
+        if (!any_dirty) break;
+    }
+
+    finished = true;
+    sync.arrive_and_wait();
+    for (auto &thread : pool) thread.join();
+    return overall;
+}
@@ -0,0 +1,131 @@
+#include "perf_counters.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <ostream>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cstring>
+#endif
+
+HardwareCounts &HardwareCounts::operator+=(const HardwareCounts &other) {
+    cycles += other.cycles;
+    instructions += other.instructions;
+    cache_misses += other.cache_misses;
+    branch_misses += other.branch_misses;
+    return *this;
+}
+
+HardwareCounts &HardwareCounts::operator-=(const HardwareCounts &other) {
+    const auto minus = [](std::uint64_t a, std::uint64_t b) { return a > b ? a - b : 0; };
+    cycles = minus(cycles, other.cycles);
+    instructions = minus(instructions, other.instructions);
+    cache_misses = minus(cache_misses, other.cache_misses);
+    branch_misses = minus(branch_misses, other.branch_misses);
+    return *this;
+}
+
+#ifdef __linux__
+
+namespace {
+
+// In the order of the fields of HardwareCounts.  The first leads the group.
+constexpr std::uint64_t events[] = {
+    PERF_COUNT_HW_CPU_CYCLES,
+    PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CACHE_MISSES,
+    PERF_COUNT_HW_BRANCH_MISSES
+};
+
+int OpenEvent(std::uint64_t event, int group) {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof attr);
+    attr.size = sizeof attr;
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = event;
+    if (group < 0) attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_ID |
+                       PERF_FORMAT_TOTAL_TIME_ENABLED |
+                       PERF_FORMAT_TOTAL_TIME_RUNNING;
+    // This thread, on any CPU.
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, group, 0));
+}
+
+}
+
+PerfCounters::PerfCounters() {
+    m_fds[0] = OpenEvent(events[0], -1);
+    if (m_fds[0] < 0) return;
+    for (int e = 1; e < event_count; ++e) m_fds[e] = OpenEvent(events[e], m_fds[0]);
+    for (int e = 0; e < event_count; ++e) {
+        if (m_fds[e] >= 0) ioctl(m_fds[e], PERF_EVENT_IOC_ID, &m_ids[e]);
+    }
+    ioctl(m_fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(m_fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+PerfCounters::~PerfCounters() {
+    for (const int fd : m_fds) {
+        if (fd >= 0) close(fd);
+    }
+}
+
+HardwareCounts PerfCounters::Read() const {
+    HardwareCounts counts;
+    if (!Available()) return counts;
+    // The number of events, the times enabled and running, and a value and
+    // an id for each event.
+    struct {
+        std::uint64_t count;
+        std::uint64_t enabled;
+        std::uint64_t running;
+        struct { std::uint64_t value, id; } values[event_count];
+    } group;
+    const ssize_t size = read(m_fds[0], &group, sizeof group);
+    if (size < static_cast<ssize_t>(3 * sizeof(std::uint64_t)) || group.running == 0) {
+        return counts;
+    }
+    const double scale = static_cast<double>(group.enabled) / static_cast<double>(group.running);
+    std::uint64_t *fields[event_count] = {
+        &counts.cycles, &counts.instructions, &counts.cache_misses, &counts.branch_misses
+    };
+    const std::uint64_t n = std::min<std::uint64_t>(group.count, event_count);
+    for (std::uint64_t k = 0; k < n; ++k) {
+        for (int e = 0; e < event_count; ++e) {
+            if (m_fds[e] >= 0 && m_ids[e] == group.values[k].id) {
+                *fields[e] = static_cast<std::uint64_t>(
+                    static_cast<double>(group.values[k].value) * scale);
+            }
+        }
+    }
+    return counts;
+}
+
+#else
+
+PerfCounters::PerfCounters() {}
+PerfCounters::~PerfCounters() {}
+HardwareCounts PerfCounters::Read() const { return HardwareCounts{}; }
+
+#endif
+
+std::ostream &operator<<(std::ostream &out, const HardwareCounts &counts) {
+    const auto flags = out.flags();
+    const auto precision = out.precision();
+    out << counts.cycles << " cycles, " << counts.instructions << " instructions ("
+        << std::fixed << std::setprecision(2)
+        << (counts.cycles == 0 ? 0.0 : static_cast<double>(counts.instructions) /
+                                       static_cast<double>(counts.cycles))
+        << " per cycle), " << counts.cache_misses << " cache misses, "
+        << counts.branch_misses << " branch misses";
+    out.flags(flags);
+    out.precision(precision);
+    return out;
+}
@@ -0,0 +1,50 @@
+// Hardware performance counters, read with perf_event_open on Linux.
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <cstdint>
+#include <iosfwd>
+
+// Counts of hardware events, in user mode.
+struct HardwareCounts {
+    std::uint64_t cycles = 0;
+    std::uint64_t instructions = 0;
+    std::uint64_t cache_misses = 0;    // usually in the last-level cache
+    std::uint64_t branch_misses = 0;
+
+    HardwareCounts &operator+=(const HardwareCounts &other);
+    // Stops at zero, since counts scaled for multiplexing can jitter.
+    HardwareCounts &operator-=(const HardwareCounts &other);
+};
+
+// Counts the events of the thread that creates it, from then on.  The
+// counters are read as a group, so the counts cover the same stretch of
+// time, and they're scaled up if the kernel had to share the hardware with
+// other groups.  Elsewhere than Linux, where the kernel forbids it (see
+// /proc/sys/kernel/perf_event_paranoid), or on machines without counters,
+// as in many virtual machines, Available is false and Read returns zeros.
+// An event the processor doesn't count stays zero.
+class PerfCounters {
+    public:
+        PerfCounters();
+        ~PerfCounters();
+        PerfCounters(const PerfCounters &) = delete;
+        PerfCounters &operator=(const PerfCounters &) = delete;
+
+        bool Available() const { return m_fds[0] >= 0; }
+
+        // One system call.
+        HardwareCounts Read() const;
+
+    private:
+        static constexpr int event_count = 4;
+        int m_fds[event_count] = {-1, -1, -1, -1};
+        // The kernel's ids of the events, which tag the values read.
+        std::uint64_t m_ids[event_count] = {};
+};
+
+// For example "1200 cycles, 1800 instructions (1.50 per cycle), 3 cache
+// misses, 7 branch misses".
+std::ostream &operator<<(std::ostream &out, const HardwareCounts &counts);
+
+#endif
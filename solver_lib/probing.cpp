@@ -0,0 +1,142 @@
+#include "probing.h"
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <thread>
+
+namespace {
+
+// Probes are handed out in blocks to keep the threads from contending for
+// the counter.
+constexpr std::size_t block_size = 16;
+
+// What the probes of one thread found.
+struct Findings {
+    std::vector<Literal> forced;
+    std::vector<Equivalence> equivalences;
+    std::size_t probes = 0;
+    bool refuted = false;
+};
+
+void ProbeSlot(const Puzzle &puzzle, const Solution &root, Index slot,
+               const SolveOptions &quiet, Findings &findings) {
+    Solution yes = root;  // copy
+    Solution no = root;   // copy
+    yes.Set(slot, YES);
+    no.Set(slot, NO);
+    const bool yes_works = puzzle.Propagate(yes, quiet) != Result::CONFLICT;
+    const bool no_works = puzzle.Propagate(no, quiet) != Result::CONFLICT;
+    findings.probes += 2;
+    if (!yes_works && !no_works) {
+        findings.refuted = true;
+        return;
+    }
+    if (!yes_works || !no_works) {
+        findings.forced.push_back(Literal{slot, yes_works ? YES : NO});
+        return;
+    }
+    for (Index i = 0; i < root.size(); ++i) {
+        if (i == slot || root[i] != MAYBE || yes[i] == MAYBE) continue;
+        if (yes[i] == no[i]) {
+            // Whatever the slot is, this follows.
+            findings.forced.push_back(Literal{i, yes[i]});
+        } else if (no[i] != MAYBE && slot < i) {
+            findings.equivalences.push_back(Equivalence{slot, Literal{i, yes[i]}});
+        }
+    }
+}
+
+}
+
+ProbeResult ProbeRoot(const Puzzle &puzzle, Solution &root,
+                      std::size_t threads) {
+    SolveOptions quiet;
+    quiet.trace = false;
+    ProbeResult probed;
+    if (puzzle.Propagate(root, quiet) == Result::CONFLICT) {
+        probed.result = Result::CONFLICT;
+        return probed;
+    }
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+
+    for (;;) {
+        ++probed.rounds;
+        IndexList maybes;
+        for (Index i = 0; i < root.size(); ++i) {
+            if (root[i] == MAYBE) maybes.push_back(i);
+        }
+
+        const std::size_t used =
+            std::clamp<std::size_t>(maybes.size(), 1, threads);
+        std::vector<Findings> findings(used);
+        std::atomic<std::size_t> next{0};
+        std::atomic<bool> refuted{false};
+        auto const worker = [&](Findings &mine) {
+            for (;;) {
+                const std::size_t start = next.fetch_add(block_size);
+                if (start >= maybes.size() || refuted) return;
+                const std::size_t end = std::min(start + block_size, maybes.size());
+                for (std::size_t k = start; k < end && !mine.refuted; ++k) {
+                    ProbeSlot(puzzle, root, maybes[k], quiet, mine);
+                }
+                if (mine.refuted) refuted = true;
+            }
+        };
+        std::vector<std::thread> pool;
+        for (std::size_t t = 1; t < used; ++t) {
+            pool.emplace_back(worker, std::ref(findings[t]));
+        }
+        worker(findings[0]);
+        for (auto &thread : pool) thread.join();
+
+        // Merge in slot order, so the result doesn't depend on which thread
+        // probed what.
+        std::vector<Literal> forced;
+        std::vector<Equivalence> equivalences;
+        for (auto &f : findings) {
+            probed.probes += f.probes;
+            forced.insert(forced.end(), f.forced.begin(), f.forced.end());
+            equivalences.insert(equivalences.end(),
+                                f.equivalences.begin(), f.equivalences.end());
+        }
+        if (refuted) {
+            probed.result = Result::CONFLICT;
+            return probed;
+        }
+        std::sort(forced.begin(), forced.end(),
+                  [](const Literal &x, const Literal &y) {
+                      return x.index < y.index ||
+                             (x.index == y.index && x.value < y.value);
+                  });
+        bool progress = false;
+        for (const auto &literal : forced) {
+            switch (root.Set(literal.index, literal.value)) {
+                case Result::CONFLICT:
+                    // Different probes forced opposite values.
+                    probed.result = Result::CONFLICT;
+                    return probed;
+                case Result::NO_CHANGE:
+                    break;
+                case Result::PROGRESS:
+                    probed.forced.push_back(literal);
+                    progress = true;
+                    break;
+            }
+        }
+        if (progress && puzzle.Propagate(root, quiet) == Result::CONFLICT) {
+            probed.result = Result::CONFLICT;
+            return probed;
+        }
+        if (!progress) {
+            std::sort(equivalences.begin(), equivalences.end(),
+                      [](const Equivalence &x, const Equivalence &y) {
+                          return x.a < y.a || (x.a == y.a && x.b.index < y.b.index);
+                      });
+            probed.equivalences = std::move(equivalences);
+            break;
+        }
+        probed.result = Result::PROGRESS;
+    }
+    return probed;
+}
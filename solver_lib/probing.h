@@ -0,0 +1,38 @@
+// Probing:  trying each value of every MAYBE at the root to find the values
+// that are forced and the slots that are equivalent.
+#ifndef PROBING_H
+#define PROBING_H
+
+#include "solver_lib/solver.h"
+
+#include <vector>
+
+// Slot a is YES exactly when b holds.
+struct Equivalence {
+    Index a;
+    Literal b;
+};
+
+struct ProbeResult {
+    // CONFLICT if the root has no solutions, PROGRESS if probing forced
+    // anything, and otherwise NO_CHANGE.
+    Result result = Result::NO_CHANGE;
+    // Values forced by a probe of one value that conflicted, or that
+    // propagation from both values agreed on.
+    std::vector<Literal> forced;
+    // Found in the last round, between slots still MAYBE afterward, with
+    // a < b.index.
+    std::vector<Equivalence> equivalences;
+    std::size_t probes = 0;
+    std::size_t rounds = 0;
+};
+
+// Propagates the root, then probes every MAYBE:  sets it YES and propagates,
+// and sets it NO and propagates, each on a copy of the root.  The probes are
+// spread over the given number of threads (zero means one per core).  Forced
+// values are applied to the root, and probing repeats until it finds
+// nothing new.  The forced values are the same for any number of threads.
+ProbeResult ProbeRoot(const Puzzle &puzzle, Solution &root,
+                      std::size_t threads = 0);
+
+#endif
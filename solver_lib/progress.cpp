@@ -0,0 +1,54 @@
+#include "progress.h"
+
+#include <cmath>
+#include <iomanip>
+#include <ostream>
+
+void PrintDuration(std::ostream &out, double seconds) {
+    const auto flags = out.flags();
+    const auto precision = out.precision();
+    out << std::fixed;
+    if (!std::isfinite(seconds)) {
+        out << "unknown time";
+    } else if (seconds < 1) {
+        out << std::setprecision(0) << seconds * 1000 << " ms";
+    } else if (seconds < 60) {
+        out << std::setprecision(1) << seconds << " s";
+    } else if (seconds < 3600) {
+        out << std::setprecision(1) << seconds / 60 << " min";
+    } else if (seconds < 86400) {
+        out << std::setprecision(1) << seconds / 3600 << " h";
+    } else if (seconds < 365 * 86400.0) {
+        out << std::setprecision(1) << seconds / 86400 << " days";
+    } else {
+        // Estimates of hopeless searches get astronomical.
+        out << std::defaultfloat << std::setprecision(3)
+            << seconds / (365 * 86400.0) << " years";
+    }
+    out.flags(flags);
+    out.precision(precision);
+}
+
+void ProgressPrinter::Report(const SearchProgress &progress) {
+    PrintDuration(m_out, progress.seconds);
+    m_out << ": " << progress.nodes << " nodes, " << progress.solutions
+          << (progress.solutions == 1 ? " solution, " : " solutions, ");
+    if (progress.run > 1) m_out << "run " << progress.run << ", ";
+    const auto flags = m_out.flags();
+    const auto precision = m_out.precision();
+    m_out << std::fixed << std::setprecision(1) << progress.done * 100 << "% done";
+    if (std::isfinite(progress.estimated_nodes)) {
+        m_out << ", about ";
+        if (progress.estimated_nodes < 1e12) {
+            m_out << std::setprecision(0) << progress.estimated_nodes;
+        } else {
+            m_out << std::scientific << std::setprecision(2) << progress.estimated_nodes;
+        }
+        m_out << " nodes and ";
+        PrintDuration(m_out, progress.estimated_seconds);
+        m_out << " left";
+    }
+    m_out.flags(flags);
+    m_out.precision(precision);
+    m_out << std::endl;
+}
@@ -0,0 +1,48 @@
+// Reporting how far along a search is, and how long it has to go.
+#ifndef PROGRESS_H
+#define PROGRESS_H
+
+#include <cstddef>
+#include <iosfwd>
+
+// A snapshot of a search in progress.  The estimates count the tree as if
+// every guess splits the remaining work in half, so the part of the tree
+// that's done is the sum of 2^-depth over the finished subtrees.  That's
+// rough early on and when the tree is lopsided, but it improves as the
+// search goes, and it costs nothing beyond looking at the stack.  They're
+// for the current run between restarts, and for finding every solution;
+// a search with a solution limit can stop sooner.
+struct SearchProgress {
+    std::size_t nodes = 0;          // in the whole search
+    std::size_t solutions = 0;
+    std::size_t run = 1;            // counting restarts
+    double seconds = 0;             // in the current run
+    double done = 0;                // the fraction of the tree
+    // Infinite until the first subtree is finished.
+    double estimated_nodes = 0;     // in the current run, in total
+    double estimated_seconds = 0;   // left
+};
+
+// Receives reports from Solve (see SolveOptions::progress), on the thread
+// that runs the search.
+class ProgressListener {
+    public:
+        virtual ~ProgressListener() = default;
+        virtual void Report(const SearchProgress &progress) = 0;
+};
+
+// Writes each report as a line, such as "12.0 s: 1850342 nodes, 3 solutions,
+// 4.1% done, about 45000000 nodes and 4.7 min left".
+class ProgressPrinter : public ProgressListener {
+    public:
+        explicit ProgressPrinter(std::ostream &out) : m_out(out) {}
+        void Report(const SearchProgress &progress) override;
+
+    private:
+        std::ostream &m_out;
+};
+
+// "850 ms", "12.0 s", "4.7 min", "3.2 h", "5.1 days", or "2.5e+07 years".
+void PrintDuration(std::ostream &out, double seconds);
+
+#endif
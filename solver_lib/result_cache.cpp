@@ -0,0 +1,278 @@
+#include "result_cache.h"
+#include "flat_model.h"
+
+#include <cstring>
+#include <filesystem>
+
+// The file starts with the magic "PZRC", a version, and eight bytes of zeros.
+// Each result follows as the two halves of its key, the number of 32-bit
+// words after them, and those words:  for each solution, the number of YES
+// slots and then their indexes.  Results are padded to a multiple of eight
+// bytes.  A result cut short by a crash is dropped when the file is opened.
+
+namespace {
+
+constexpr char magic[4] = {'P', 'Z', 'R', 'C'};
+constexpr std::uint32_t version = 1;
+constexpr std::uint64_t header_size = 16;
+constexpr std::uint64_t result_header_size = 24;
+
+// The finalizer of SplitMix64, which spreads every input bit over the output.
+std::uint64_t Mix(std::uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111eb;
+    return x ^ (x >> 31);
+}
+
+// Two differently seeded chains of Mix, for 128 bits.
+class Hasher {
+    public:
+        void Add(std::uint64_t word) {
+            m_a = Mix(m_a ^ word);
+            m_b = Mix(m_b + word + 0x9e3779b97f4a7c15);
+            ++m_words;
+        }
+
+        void Add(const void *data, std::size_t size) {
+            const auto *bytes = static_cast<const unsigned char *>(data);
+            std::size_t i = 0;
+            for (; i + 8 <= size; i += 8) {
+                std::uint64_t word;
+                std::memcpy(&word, bytes + i, 8);
+                Add(word);
+            }
+            std::uint64_t tail = 0;
+            std::memcpy(&tail, bytes + i, size - i);
+            Add(tail);
+            Add(size);
+        }
+
+        CacheKey Key() const { return CacheKey{Mix(m_a ^ m_words), Mix(m_b + m_words)}; }
+
+    private:
+        std::uint64_t m_a = 0x6a09e667f3bcc908;
+        std::uint64_t m_b = 0xbb67ae8584caa73b;
+        std::uint64_t m_words = 0;
+};
+
+std::uint64_t Padded(std::uint64_t bytes) { return (bytes + 7) / 8 * 8; }
+
+// Checks the words of a result and decodes them if yes isn't null.
+bool Decode(const std::uint32_t *words, std::uint64_t count,
+            std::vector<IndexList> *yes) {
+    for (std::uint64_t k = 0; k < count; ) {
+        const std::uint64_t n = words[k++];
+        if (n > count - k) return false;
+        if (yes != nullptr) yes->emplace_back(words + k, words + k + n);
+        k += n;
+    }
+    return true;
+}
+
+}
+
+bool Fingerprint(const Puzzle &puzzle, CacheKey &fingerprint) {
+    const auto model = puzzle.Flatten();
+    if (!model) return false;
+    Hasher hasher;
+    hasher.Add(model->Data(), model->Size());
+    fingerprint = hasher.Key();
+    return true;
+}
+
+CacheKey MakeCacheKey(const CacheKey &fingerprint,
+                      const std::vector<Literal> &assumptions,
+                      const SolveOptions &options) {
+    Hasher hasher;
+    hasher.Add(fingerprint.a);
+    hasher.Add(fingerprint.b);
+    hasher.Add(assumptions.size());
+    for (const auto &literal : assumptions) {
+        hasher.Add(literal.index * 2 + (literal.value == YES ? 1 : 0));
+    }
+    hasher.Add(options.solution_limit);
+    hasher.Add(static_cast<std::uint64_t>(options.branching));
+    hasher.Add(static_cast<std::uint64_t>(options.value_order));
+    hasher.Add(options.restart_base);
+    hasher.Add(options.seed);
+    hasher.Add(options.nogood_length);
+    return hasher.Key();
+}
+
+ResultCache::ResultCache(std::size_t capacity, const std::string &path) :
+    m_capacity(capacity)
+{
+    if (!path.empty()) OpenFile(path);
+}
+
+void ResultCache::OpenFile(const std::string &path) {
+    std::error_code error;
+    if (!std::filesystem::exists(path, error)) {
+        std::ofstream out(path, std::ios::binary);
+        const std::uint64_t zero = 0;
+        out.write(magic, sizeof magic);
+        out.write(reinterpret_cast<const char *>(&version), sizeof version);
+        out.write(reinterpret_cast<const char *>(&zero), sizeof zero);
+        if (!out) return;
+    }
+    if (!m_file.Open(path) || m_file.Size() < header_size ||
+        std::memcmp(m_file.Data(), magic, sizeof magic) != 0) {
+        return;
+    }
+    std::uint32_t file_version = 0;
+    const auto *bytes = static_cast<const unsigned char *>(m_file.Data());
+    std::memcpy(&file_version, bytes + sizeof magic, sizeof file_version);
+    if (file_version != version) return;
+
+    // Index the results, stopping at the first one that's cut short.
+    std::uint64_t offset = header_size;
+    while (offset + result_header_size <= m_file.Size()) {
+        std::uint64_t header[3];
+        std::memcpy(header, bytes + offset, sizeof header);
+        const std::uint64_t room = m_file.Size() - offset - result_header_size;
+        if (header[2] > room / 4 || Padded(header[2] * 4) > room) break;
+        const auto *words = reinterpret_cast<const std::uint32_t *>(
+            bytes + offset + result_header_size);
+        if (!Decode(words, header[2], nullptr)) break;
+        m_offsets[CacheKey{header[0], header[1]}] = offset;
+        offset += result_header_size + Padded(header[2] * 4);
+    }
+    m_end = offset;
+    if (m_end < m_file.Size()) {
+        m_file.Close();
+        std::filesystem::resize_file(path, m_end, error);
+        if (error || !m_file.Open(path)) return;
+    }
+    m_path = path;
+    m_log.open(path, std::ios::binary | std::ios::app);
+}
+
+std::vector<Solution> ResultCache::Solve(const Puzzle &puzzle,
+                                         const std::vector<Literal> &assumptions,
+                                         const SolveOptions &options,
+                                         SolveStatistics *stats) {
+    CacheKey fingerprint;
+    if (!Fingerprint(puzzle, fingerprint)) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            ++m_counts.uncacheable;
+        }
+        return puzzle.Solve(assumptions, options, stats);
+    }
+    return Solve(puzzle, fingerprint, assumptions, options, stats);
+}
+
+std::vector<Solution> ResultCache::Solve(const Puzzle &puzzle,
+                                         const CacheKey &fingerprint,
+                                         const std::vector<Literal> &assumptions,
+                                         const SolveOptions &options,
+                                         SolveStatistics *stats) {
+    const CacheKey key = MakeCacheKey(fingerprint, assumptions, options);
+    std::vector<IndexList> yes;
+    if (Find(key, yes)) {
+        std::vector<Solution> solutions;
+        for (const auto &slots : yes) {
+            Solution s(puzzle.SlotCount());
+            for (const Index i : slots) s.Set(i, YES);
+            for (Index i = 0; i < s.size(); ++i) s.Set(i, NO);
+            solutions.push_back(std::move(s));
+        }
+        if (stats != nullptr) {
+            *stats = SolveStatistics{};
+            stats->solutions = solutions.size();
+        }
+        return solutions;
+    }
+
+    SolveStatistics counts;
+    auto solutions = puzzle.Solve(assumptions, options, &counts);
+    if (stats != nullptr) *stats = counts;
+    if (!counts.gave_up && !counts.cancelled) {
+        Entry entry{key, {}};
+        for (const auto &s : solutions) {
+            IndexList slots;
+            for (Index i = 0; i < s.size(); ++i) {
+                if (s[i] == YES) slots.push_back(i);
+            }
+            entry.yes.push_back(std::move(slots));
+        }
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_log.is_open() && m_offsets.count(key) == 0) Append(entry);
+        Remember(std::move(entry));
+    }
+    return solutions;
+}
+
+ResultCache::Counts ResultCache::GetCounts() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_counts;
+}
+
+bool ResultCache::Find(const CacheKey &key, std::vector<IndexList> &yes) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const auto found = m_entries.find(key);
+    if (found != m_entries.end()) {
+        m_recent.splice(m_recent.begin(), m_recent, found->second);
+        yes = found->second->yes;
+        ++m_counts.hits;
+        return true;
+    }
+    const auto stored = m_offsets.find(key);
+    if (stored != m_offsets.end() && ReadFromFile(stored->second, yes)) {
+        Remember(Entry{key, yes});
+        ++m_counts.disk_hits;
+        return true;
+    }
+    ++m_counts.misses;
+    return false;
+}
+
+bool ResultCache::ReadFromFile(std::uint64_t offset, std::vector<IndexList> &yes) {
+    if (offset + result_header_size > m_file.Size()) {
+        // Appended since the file was mapped.
+        m_log.flush();
+        if (!m_file.Open(m_path)) return false;
+    }
+    const auto *bytes = static_cast<const unsigned char *>(m_file.Data());
+    std::uint64_t header[3];
+    std::memcpy(header, bytes + offset, sizeof header);
+    const auto *words = reinterpret_cast<const std::uint32_t *>(
+        bytes + offset + result_header_size);
+    return Decode(words, header[2], &yes);
+}
+
+void ResultCache::Remember(Entry entry) {
+    if (m_capacity == 0) return;
+    const auto found = m_entries.find(entry.key);
+    if (found != m_entries.end()) {
+        m_recent.erase(found->second);
+        m_entries.erase(found);
+    }
+    m_recent.push_front(std::move(entry));
+    m_entries[m_recent.front().key] = m_recent.begin();
+    if (m_recent.size() > m_capacity) {
+        m_entries.erase(m_recent.back().key);
+        m_recent.pop_back();
+    }
+}
+
+void ResultCache::Append(const Entry &entry) {
+    std::vector<std::uint32_t> words;
+    for (const auto &slots : entry.yes) {
+        words.push_back(static_cast<std::uint32_t>(slots.size()));
+        for (const Index i : slots) words.push_back(static_cast<std::uint32_t>(i));
+    }
+    const std::uint64_t header[3] = {entry.key.a, entry.key.b, words.size()};
+    const std::uint64_t padding = Padded(words.size() * 4) - words.size() * 4;
+    const char zeros[8] = {};
+    m_log.write(reinterpret_cast<const char *>(header), sizeof header);
+    m_log.write(reinterpret_cast<const char *>(words.data()),
+                static_cast<std::streamsize>(words.size() * 4));
+    m_log.write(zeros, static_cast<std::streamsize>(padding));
+    m_log.flush();
+    if (!m_log) return;
+    m_offsets[entry.key] = m_end;
+    m_end += result_header_size + words.size() * 4 + padding;
+}
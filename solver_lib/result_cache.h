@@ -0,0 +1,113 @@
+// Remembering the results of searches, so that solving the same puzzle again
+// is a lookup.
+#ifndef RESULT_CACHE_H
+#define RESULT_CACHE_H
+
+#include "solver_lib/mapped_file.h"
+#include "solver_lib/solver.h"
+
+#include <cstdint>
+#include <fstream>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// A 128-bit hash.  It isn't cryptographic; it only has to make accidental
+// collisions between puzzles vanishingly unlikely.
+struct CacheKey {
+    std::uint64_t a = 0;
+    std::uint64_t b = 0;
+
+    bool operator==(const CacheKey &other) const {
+        return a == other.a && b == other.b;
+    }
+};
+
+// Hashes the puzzle's constraints, as a flat model.  Returns false if some
+// constraint can't be flattened, and then the puzzle can't be cached.
+bool Fingerprint(const Puzzle &puzzle, CacheKey &fingerprint);
+
+// Combines a puzzle's fingerprint with the other things that determine what
+// Solve returns:  the assumptions and the options that affect which
+// solutions are found and in what order.  The node limit isn't one of them,
+// since only complete results are cached.
+CacheKey MakeCacheKey(const CacheKey &fingerprint,
+                      const std::vector<Literal> &assumptions,
+                      const SolveOptions &options);
+
+// Keeps the most recently used results in memory.  Given a file, it also
+// appends every new result to the file and finds the results stored there
+// by earlier runs through a memory mapping, without loading them.  Only one
+// process should write to a file at a time.  All the methods are safe to
+// call from several threads.
+class ResultCache {
+    public:
+        explicit ResultCache(std::size_t capacity = 1024,
+                             const std::string &path = {});
+
+        // Like Puzzle::Solve, but looks for the result first.  Results of
+        // searches that gave up or were cancelled aren't remembered.  A
+        // remembered result counts its solutions in the statistics, and no
+        // nodes.
+        std::vector<Solution> Solve(const Puzzle &puzzle,
+                                    const std::vector<Literal> &assumptions,
+                                    const SolveOptions &options,
+                                    SolveStatistics *stats = nullptr);
+
+        // The same, for callers that solve the same rules many times and
+        // have already taken their fingerprint.
+        std::vector<Solution> Solve(const Puzzle &puzzle,
+                                    const CacheKey &fingerprint,
+                                    const std::vector<Literal> &assumptions,
+                                    const SolveOptions &options,
+                                    SolveStatistics *stats = nullptr);
+
+        // False if a file was given but couldn't be used.
+        bool Persistent() const { return m_log.is_open(); }
+
+        struct Counts {
+            std::size_t hits = 0;       // in memory
+            std::size_t disk_hits = 0;  // in the file
+            std::size_t misses = 0;
+            std::size_t uncacheable = 0;
+        };
+        Counts GetCounts() const;
+
+    private:
+        struct KeyHash {
+            std::size_t operator()(const CacheKey &key) const {
+                return static_cast<std::size_t>(key.a);
+            }
+        };
+
+        // The YES slots of each solution.
+        struct Entry {
+            CacheKey key;
+            std::vector<IndexList> yes;
+        };
+
+        void OpenFile(const std::string &path);
+        bool Find(const CacheKey &key, std::vector<IndexList> &yes);
+        bool ReadFromFile(std::uint64_t offset, std::vector<IndexList> &yes);
+        void Remember(Entry entry);
+        void Append(const Entry &entry);
+
+        mutable std::mutex m_mutex;
+        std::size_t m_capacity;
+        // From the most recently used to the least.
+        std::list<Entry> m_recent;
+        std::unordered_map<CacheKey, std::list<Entry>::iterator, KeyHash> m_entries;
+
+        std::string m_path;
+        MappedFile m_file;
+        std::ofstream m_log;
+        // Where each result in the file starts.
+        std::unordered_map<CacheKey, std::uint64_t, KeyHash> m_offsets;
+        std::uint64_t m_end = 0;
+
+        Counts m_counts;
+};
+
+#endif
@@ -0,0 +1,58 @@
+#include "search_tree.h"
+
+#include <bit>
+#include <cstring>
+
+namespace {
+
+constexpr char magic[4] = {'P', 'Z', 'S', 'T'};
+constexpr std::uint32_t version = 1;
+
+static_assert(sizeof(SearchTreeNode) == 24);
+static_assert(std::endian::native == std::endian::little,
+              "search trees are written little-endian");
+
+}
+
+bool SearchTreeWriter::Open(const std::string &path, std::size_t slots) {
+    m_file.open(path, std::ios::binary | std::ios::trunc);
+    m_written = 0;
+    const std::uint64_t count = slots;
+    m_file.write(magic, sizeof magic);
+    m_file.write(reinterpret_cast<const char *>(&version), sizeof version);
+    m_file.write(reinterpret_cast<const char *>(&count), sizeof count);
+    if (!m_file) {
+        m_file.close();
+        return false;
+    }
+    return true;
+}
+
+void SearchTreeWriter::Write(const SearchTreeNode &node) {
+    m_file.write(reinterpret_cast<const char *>(&node), sizeof node);
+    ++m_written;
+}
+
+bool ReadSearchTree(const std::string &path, std::vector<SearchTreeNode> &nodes,
+                    std::size_t &slots) {
+    std::ifstream in(path, std::ios::binary);
+    char file_magic[sizeof magic];
+    std::uint32_t file_version = 0;
+    std::uint64_t count = 0;
+    in.read(file_magic, sizeof file_magic);
+    in.read(reinterpret_cast<char *>(&file_version), sizeof file_version);
+    in.read(reinterpret_cast<char *>(&count), sizeof count);
+    if (!in || std::memcmp(file_magic, magic, sizeof magic) != 0 ||
+        file_version != version) {
+        return false;
+    }
+    slots = static_cast<std::size_t>(count);
+    nodes.clear();
+    SearchTreeNode node;
+    while (in.read(reinterpret_cast<char *>(&node), sizeof node)) {
+        // Parents come first.
+        if (node.parent != no_parent && node.parent >= nodes.size()) break;
+        nodes.push_back(node);
+    }
+    return true;
+}
@@ -0,0 +1,58 @@
+// Recording the search tree that Solve explores, for analysis afterwards.
+#ifndef SEARCH_TREE_H
+#define SEARCH_TREE_H
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+enum class NodeOutcome : std::uint8_t {
+    CONFLICT = 1,   // propagation found a contradiction
+    BRANCHED,       // two guesses were pushed
+    SOLUTION
+};
+
+// One candidate that the search examined.  Nodes are numbered from 0 in
+// the order they were examined, and the file lists them in that order.
+// The numbers count only the nodes in the file, so a search resumed from
+// a checkpoint starts again from 0 in its new file.  A
+// node's parent is examined before it.  Roots have no parent and no slot:
+// the root of each run between restarts, and the candidates that a search
+// resumed from a checkpoint.
+struct SearchTreeNode {
+    std::uint64_t parent;
+    std::uint32_t slot;     // the guess that led here
+    std::int8_t value;      // YES or NO, MAYBE for a root
+    NodeOutcome outcome;
+    std::uint16_t reserved;
+    std::uint32_t passes;   // through the constraints, in propagation
+    std::uint32_t fixed;    // slots that propagation decided
+};
+
+constexpr std::uint64_t no_parent = ~std::uint64_t{0};
+
+// The file is the magic "PZST", a version, and the number of slots, then
+// the nodes as they're written, all little-endian.
+class SearchTreeWriter {
+    public:
+        // Returns false if the file can't be created.
+        bool Open(const std::string &path, std::size_t slots);
+        bool IsOpen() const { return m_file.is_open(); }
+        void Write(const SearchTreeNode &node);
+        void Close() { m_file.close(); }
+
+        // The number of nodes written, which is the next node's number.
+        std::uint64_t Written() const { return m_written; }
+
+    private:
+        std::ofstream m_file;
+        std::uint64_t m_written = 0;
+};
+
+// Returns false if the file can't be read or isn't a search tree.  A node
+// cut short, as by a crash, is dropped, along with anything after it.
+bool ReadSearchTree(const std::string &path, std::vector<SearchTreeNode> &nodes,
+                    std::size_t &slots);
+
+#endif
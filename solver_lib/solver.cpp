@@ -1,8 +1,20 @@
 #include "solver.h"
+#include "checkpoint.h"
+#include "flat_model.h"
+#include "nogoods.h"
+#include "progress.h"
+#include "search_tree.h"
 
 #include <cassert>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
 #include <iostream>
-#include <stack>
+#include <limits>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <thread>
 
 Index Solution::FirstMaybe() const {
     const auto it =
@@ -16,6 +28,7 @@ Result Solution::Set(Index index, Truth value) {
     if (m_table[index] == value) return Result::NO_CHANGE;
     if (m_table[index] != MAYBE) return Result::CONFLICT;
     m_table[index] = value;
+    --m_maybes;
     return Result::PROGRESS;
 }
 
@@ -25,61 +38,1077 @@ std::size_t Solution::Count(const IndexList &indexes, Truth value) const {
 }
 
 
-std::vector<Solution> Puzzle::Solve() const {
+namespace {
+
+// The Luby sequence (1, 1, 2, 1, 1, 2, 4, 1, 1, 2, 1, 1, 2, 4, 8, ...) is a
+// restart schedule that's within a log factor of the best fixed interval for
+// any problem.  The argument is 1-based.
+std::size_t Luby(std::size_t i) {
+    for (;;) {
+        std::size_t k = 1;
+        while ((std::size_t{1} << k) - 1 < i) ++k;
+        if ((std::size_t{1} << k) - 1 == i) return std::size_t{1} << (k - 1);
+        i -= (std::size_t{1} << (k - 1)) - 1;
+    }
+}
+
+// The most nogoods a search keeps.  Beyond that, it keeps only the newest
+// half.
+constexpr std::size_t max_nogoods = 10000;
+// A search imports other searches' nogoods when it restarts and after this
+// many conflicts.
+constexpr std::size_t import_interval = 64;
+
+}
+
+// The state of a single call to Solve, or of the search of one subtree.
+class Puzzle::Search {
+    public:
+        // A candidate to explore, kept as the nearest saved candidate above
+        // it in the tree (its snapshot, which nodes share) together with all
+        // the guesses that led to it.  Those made below the snapshot's depth
+        // have to be replayed to rebuild the candidate.
+        struct Node {
+            std::shared_ptr<const Solution> snapshot;
+            std::size_t snapshot_depth;
+            std::vector<Literal> path;
+            // The node that pushed it, for the search tree.
+            std::uint64_t parent = no_parent;
+        };
+
+        static Node Start(Solution candidate, std::vector<Literal> path) {
+            const std::size_t depth = path.size();
+            return Node{std::make_shared<const Solution>(std::move(candidate)),
+                        depth, std::move(path)};
+        }
+
+        // A subtree left for later by Split, and the number of solutions
+        // that precede it.
+        struct Subtree {
+            Node root;
+            std::size_t solutions_before;
+        };
+
+        Search(const Puzzle &puzzle, const SolveOptions &options) :
+            Search(puzzle, options, Start(Solution(puzzle.m_slot_count), {})) {}
+
+        Search(const Puzzle &puzzle, const SolveOptions &options, Node root) :
+            m_puzzle(puzzle), m_options(options), m_rng(options.seed),
+            m_root(std::move(root)),
+            m_source(reinterpret_cast<std::uintptr_t>(this)) {}
+
+        // Instead of exploring candidates this many guesses deep, Run
+        // appends them to the frontier.
+        void Split(std::size_t depth, std::vector<Subtree> *frontier) {
+            m_split_depth = depth;
+            m_frontier = frontier;
+        }
+
+        // Run also stops soon after this flag is set.
+        void HaltOn(const std::atomic<bool> *halt) { m_halt = halt; }
+
+        std::vector<Solution> Run();
+
+        // See Puzzle::EstimateNodes.
+        double EstimateNodes(std::size_t probes);
+
+        const SolveStatistics &Statistics() const { return m_counts; }
+
+    private:
+        enum class Outcome { FINISHED, RESTART, STOPPED };
+
+        // The state of one run of the search, between restarts.
+        struct Frontier {
+            std::vector<Node> candidates;   // a stack
+            // The guesses that led to the previous candidate, and the number
+            // of solutions found before reaching each level of them.
+            std::vector<Literal> previous;
+            std::vector<std::size_t> found_before;
+            std::size_t conflicts = 0;
+            // The part of the tree finished, for progress reports:  each
+            // leaf d guesses below the root is 2^-d of it.  (Summing the
+            // leaves keeps the tiny parts that 1 minus the open subtrees
+            // would round away.)
+            double done = 0;
+        };
+
+        Outcome RunOnce(std::size_t conflict_limit, Frontier &frontier,
+                        std::vector<Solution> &solutions);
+        bool Stopping();
+        void SaveCheckpoint(const Frontier &frontier,
+                            const std::vector<Solution> &solutions);
+        bool LoadCheckpoint(Frontier &frontier, std::vector<Solution> &solutions);
+        Result Deduce(Solution &candidate, std::size_t *culprit);
+        Result ApplyNogoods(Solution &candidate);
+        void Learn(const std::vector<Literal> &path, std::size_t length);
+        void Import();
+        void Forget();
+        void LoadScopes();
+        Index ChooseSlot(const Solution &candidate);
+        Truth FirstGuess();
+        std::size_t SnapshotInterval(std::size_t depth) const;
+        void ReportProgress(const Frontier &frontier,
+                            const std::vector<Solution> &solutions);
+
+        const Puzzle &m_puzzle;
+        const SolveOptions &m_options;
+        SolveStatistics m_counts;
+        std::mt19937_64 m_rng;
+        // The scope of constraint c is m_scopes[m_starts[c]] up to (but not
+        // including) m_scopes[m_starts[c+1]].
+        std::vector<std::size_t> m_starts;
+        IndexList m_scopes;
+        std::vector<std::size_t> m_weights;
+        std::vector<std::size_t> m_scores;
+        std::vector<std::vector<Literal>> m_nogoods;
+        Node m_root;
+        std::size_t m_split_depth = 0;
+        std::vector<Subtree> *m_frontier = nullptr;
+        const std::atomic<bool> *m_halt = nullptr;
+        std::uint64_t m_source;
+        std::uint64_t m_cursor = 0;
+        std::size_t m_run = 1;
+        // Nodes at the last attempt to save a checkpoint.  One that fails
+        // is tried again an interval later.
+        std::size_t m_checkpointed_at = 0;
+        CacheKey m_fingerprint;             // of the puzzle, for checkpoints
+        // With SolveOptions::count_events.  Run creates them, so that they
+        // count the thread that runs the search.
+        std::unique_ptr<PerfCounters> m_events;
+        SearchTreeWriter m_tree;
+        std::chrono::steady_clock::time_point m_start;  // of Run
+        // For progress reports:  when the current run started, how many
+        // nodes came before it, and when the last report was.
+        std::chrono::steady_clock::time_point m_run_start;
+        std::size_t m_run_nodes = 0;
+        std::chrono::steady_clock::time_point m_reported;
+};
+
+std::vector<Solution> Puzzle::Search::Run() {
+    if (m_options.branching == Branching::FEWEST_MAYBES ||
+        m_options.branching == Branching::CONFLICT_WEIGHTED) {
+        LoadScopes();
+    }
+    if (m_options.branching == Branching::CONFLICT_WEIGHTED) {
+        m_weights.assign(m_puzzle.ConstraintCount(), 1);
+    }
+
+    // Everything in the search that isn't propagation or collecting
+    // solutions is branching.
+    const AllocationTracker allocations;
+    const AllocationPhaseScope phase(AllocationPhase::BRANCHING);
+    if (m_options.count_events) {
+        m_events = std::make_unique<PerfCounters>();
+        if (!m_events->Available()) m_events.reset();
+    }
+    const HardwareCounts propagated = m_counts.propagation_events;
+    if (!m_options.search_tree.empty()) {
+        m_tree.Open(m_options.search_tree, m_puzzle.m_slot_count);
+    }
+
+    // Zero if the constraints can't be flattened.
+    if (!m_options.checkpoint.empty()) Fingerprint(m_puzzle, m_fingerprint);
+
+    m_start = std::chrono::steady_clock::now();
     std::vector<Solution> solutions;
-    std::stack<Solution> candidates;
-    candidates.emplace(Solution(m_slot_count));
+    Frontier frontier;
+    bool resuming = m_options.resume && LoadCheckpoint(frontier, solutions);
+    for (;; ++m_run) {
+        const std::size_t conflict_limit = m_options.restart_base * Luby(m_run);
+        if (!resuming) {
+            solutions.clear();
+            frontier = Frontier{};
+            frontier.candidates.push_back(m_root);
+        }
+        resuming = false;
+        Import();
+        if (RunOnce(conflict_limit, frontier, solutions) != Outcome::RESTART) break;
+        ++m_counts.restarts;
+        if (m_options.trace) std::cout << "Restarting.\n";
+    }
+    m_counts.solutions = solutions.size();
+    if (!m_options.checkpoint.empty()) SaveCheckpoint(frontier, solutions);
+    if (m_events) {
+        HardwareCounts rest = m_events->Read();
+        HardwareCounts propagation = m_counts.propagation_events;
+        propagation -= propagated;
+        rest -= propagation;
+        m_counts.search_events += rest;
+        m_events.reset();
+    }
+    m_counts.allocations += allocations.Statistics();
+    m_counts.seconds +=
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count();
+    m_tree.Close();
+    return solutions;
+}
+
+Puzzle::Search::Outcome Puzzle::Search::RunOnce(
+    std::size_t conflict_limit,
+    Frontier &frontier,
+    std::vector<Solution> &solutions
+) {
+    const bool trace = m_options.trace;
+    m_run_start = m_reported = std::chrono::steady_clock::now();
+    m_run_nodes = m_counts.nodes;
+    auto &candidates = frontier.candidates;
+    auto &previous = frontier.previous;
+    auto &found_before = frontier.found_before;
     while (!candidates.empty()) {
-        // Deduce as much as we can.
-        Solution &candidate = candidates.top();
-        Result result;
-        do {
-            result = ApplyConstraints(candidate);
-        } while (result == Result::PROGRESS);
+        if (m_options.solution_limit != 0 &&
+            solutions.size() >= m_options.solution_limit) {
+            break;
+        }
+        if (Stopping()) return Outcome::STOPPED;
+        if (!m_options.checkpoint.empty() && m_options.checkpoint_interval != 0 &&
+            m_counts.nodes >= m_checkpointed_at + m_options.checkpoint_interval) {
+            SaveCheckpoint(frontier, solutions);
+        }
+        Node &node = candidates.back();
+        const std::size_t depth = node.path.size();
+        if (m_frontier != nullptr && depth == m_split_depth) {
+            m_frontier->push_back(Subtree{std::move(node), solutions.size()});
+            candidates.pop_back();
+            continue;
+        }
+        ++m_counts.nodes;
+        if (m_options.progress != nullptr && m_counts.nodes % 256 == 0) {
+            ReportProgress(frontier, solutions);
+        }
+
+        // Candidates are explored depth first, so if this one is no deeper
+        // than the previous, the previous was in the subtree of its sibling,
+        // which has now been explored completely.  If that produced no
+        // solutions, the sibling's guesses form a nogood.
+        if (depth != 0 && depth <= previous.size()) {
+            assert(previous[depth-1].index == node.path[depth-1].index);
+            if (found_before[depth] == solutions.size()) Learn(previous, depth);
+        }
+        previous = node.path;
+        found_before.resize(depth + 1);
+        found_before[depth] = solutions.size();
+
+        // Rebuild the candidate from its snapshot.  The guesses were MAYBEs
+        // in the parent, so they're still MAYBEs in the snapshot.
+        Solution candidate = *node.snapshot;  // copy
+        for (std::size_t k = node.snapshot_depth; k < depth; ++k) {
+            const Literal &guess = node.path[k];
+            [[maybe_unused]] const Result replay =
+                candidate.Set(guess.index, guess.value);
+            assert(replay != Result::CONFLICT);
+        }
+        if (depth > node.snapshot_depth + 1) {
+            m_counts.replayed += depth - node.snapshot_depth - 1;
+        }
+
+        m_counts.max_depth = std::max(m_counts.max_depth, depth - m_root.path.size());
 
-        if (result == Result::CONFLICT) {
+        // Describes the node in the search tree, if it's being recorded.
+        // Its number is its position in the file, not the node count, which
+        // includes the nodes before a checkpoint.
+        SearchTreeNode record{};
+        const std::uint64_t id = m_tree.Written();
+        const std::size_t open = candidate.Maybes();
+        const std::size_t passes = m_counts.passes;
+        std::size_t fixed = 0;
+        if (m_tree.IsOpen()) {
+            record.parent = node.parent;
+            record.slot = std::numeric_limits<std::uint32_t>::max();
+            record.value = MAYBE;
+            if (node.parent != no_parent) {
+                record.slot = static_cast<std::uint32_t>(node.path.back().index);
+                record.value = static_cast<std::int8_t>(node.path.back().value);
+            }
+        }
+        const auto recorded = [&](NodeOutcome outcome) {
+            if (!m_tree.IsOpen()) return;
+            record.outcome = outcome;
+            record.passes = static_cast<std::uint32_t>(m_counts.passes - passes);
+            record.fixed = static_cast<std::uint32_t>(fixed);
+            m_tree.Write(record);
+        };
+
+        // Deduce as much as we can.
+        std::size_t culprit = m_puzzle.ConstraintCount();
+        const HardwareCounts before = m_events ? m_events->Read() : HardwareCounts{};
+        std::chrono::steady_clock::time_point propagation_start;
+        if (m_options.time_propagation) {
+            propagation_start = std::chrono::steady_clock::now();
+        }
+        bool dead_end;
+        {
+            const AllocationPhaseScope propagation(AllocationPhase::PROPAGATION);
+            dead_end =
+                (m_options.propagation_threads > 1 && depth == m_root.path.size() &&
+                 m_puzzle.PropagatePartitioned(candidate,
+                                               m_options.propagation_threads,
+                                               &m_counts) == Result::CONFLICT) ||
+                Deduce(candidate, &culprit) == Result::CONFLICT;
+        }
+        if (m_events) {
+            m_counts.propagation_events += m_events->Read();
+            m_counts.propagation_events -= before;
+        }
+        if (m_options.time_propagation) {
+            m_counts.propagation_seconds += std::chrono::duration<double>(
+                std::chrono::steady_clock::now() - propagation_start).count();
+        }
+        fixed = open - candidate.Maybes();
+        m_counts.propagated += fixed;
+        m_counts.max_passes = std::max(m_counts.max_passes, m_counts.passes - passes);
+        if (dead_end) {
             // This candidate is a dead end.
-            candidates.pop();
-            std::cout << "Pruning: Candidate is not consistent.\n";
+            recorded(NodeOutcome::CONFLICT);
+            ++m_counts.conflicts;
+            frontier.done +=
+                std::ldexp(1.0, -static_cast<int>(depth - m_root.path.size()));
+            if (!m_weights.empty() && culprit < m_weights.size()) {
+                ++m_weights[culprit];
+            }
+            candidates.pop_back();
+            if (trace) std::cout << "Pruning: Candidate is not consistent.\n";
+            if (++frontier.conflicts == conflict_limit) return Outcome::RESTART;
+            if (frontier.conflicts % import_interval == 0) Import();
             continue;
         }
-                
-        const Index first_maybe = candidate.FirstMaybe();
-        if (first_maybe == candidate.size()) {
+
+        const Index slot = ChooseSlot(candidate);
+        if (slot == candidate.size()) {
             // No MAYBEs left, so the candidate is an actual solution.
-            solutions.push_back(std::move(candidate));
-            candidates.pop();
-            std::cout << "Solution!\n";
+            recorded(NodeOutcome::SOLUTION);
+            frontier.done +=
+                std::ldexp(1.0, -static_cast<int>(depth - m_root.path.size()));
+            {
+                const AllocationPhaseScope collecting(AllocationPhase::SOLUTIONS);
+                solutions.push_back(std::move(candidate));
+            }
+            candidates.pop_back();
+            if (trace) std::cout << "Solution!\n";
+            if (solutions.size() == m_options.solution_limit) break;
             continue;
         }
-                
-        // Replace current candidate with two guesses.
-        Solution guess1 = candidate;  // copy
-        Solution guess2 = candidate;  // copy
-        candidates.pop();
-        guess1.Set(first_maybe, NO);
-        candidates.push(std::move(guess1));
-        guess2.Set(first_maybe, YES);
-        candidates.push(std::move(guess2));
-        std::cout << "Guessing: Index " << first_maybe << ".\n";
+
+        // Replace current candidate with two guesses.  The one pushed last
+        // is explored first.  They share a snapshot of this candidate if
+        // they'd otherwise be too far from the current one, or if it's a
+        // snapshot of this candidate before propagation.
+        recorded(NodeOutcome::BRANCHED);
+        const Truth first = FirstGuess();
+        Node guess2 = std::move(node);
+        guess2.parent = id;
+        candidates.pop_back();
+        if (guess2.snapshot_depth == depth ||
+            depth + 1 - guess2.snapshot_depth > SnapshotInterval(depth)) {
+            guess2.snapshot = std::make_shared<const Solution>(std::move(candidate));
+            guess2.snapshot_depth = depth;
+        }
+        Node guess1 = guess2;  // copies the path, but shares the snapshot
+        guess1.path.push_back(Literal{slot, !first});
+        candidates.push_back(std::move(guess1));
+        guess2.path.push_back(Literal{slot, first});
+        candidates.push_back(std::move(guess2));
+        m_counts.max_candidates = std::max(m_counts.max_candidates, candidates.size());
+        ++m_counts.guesses;
+        if (trace) std::cout << "Guessing: Index " << slot << ".\n";
     }
-    return solutions;
+    return Outcome::FINISHED;
+}
+
+void Puzzle::Search::ReportProgress(const Frontier &frontier,
+                                    const std::vector<Solution> &solutions) {
+    const auto now = std::chrono::steady_clock::now();
+    const std::chrono::duration<double> since = now - m_reported;
+    if (since.count() < m_options.progress_interval) return;
+    m_reported = now;
+
+    SearchProgress progress;
+    progress.nodes = m_counts.nodes;
+    progress.solutions = solutions.size();
+    progress.run = m_run;
+    progress.seconds = std::chrono::duration<double>(now - m_run_start).count();
+    progress.done = std::min(frontier.done, 1.0);
+    progress.estimated_nodes = std::numeric_limits<double>::infinity();
+    progress.estimated_seconds = std::numeric_limits<double>::infinity();
+    if (progress.done > 0) {
+        const double run_nodes = static_cast<double>(m_counts.nodes - m_run_nodes);
+        progress.estimated_nodes = run_nodes / progress.done;
+        progress.estimated_seconds =
+            progress.seconds * (1 - progress.done) / progress.done;
+    }
+    m_options.progress->Report(progress);
+}
+
+double Puzzle::Search::EstimateNodes(std::size_t probes) {
+    if (m_options.branching == Branching::FEWEST_MAYBES ||
+        m_options.branching == Branching::CONFLICT_WEIGHTED) {
+        LoadScopes();
+    }
+    if (m_options.branching == Branching::CONFLICT_WEIGHTED) {
+        m_weights.assign(m_puzzle.ConstraintCount(), 1);
+    }
+    if (probes == 0) return 0;
+    double total = 0;
+    for (std::size_t probe = 0; probe < probes; ++probe) {
+        Solution candidate = *m_root.snapshot;  // copy
+        double width = 1;
+        for (;;) {
+            ++m_counts.nodes;
+            total += width;
+            std::size_t culprit = m_puzzle.ConstraintCount();
+            if (Deduce(candidate, &culprit) == Result::CONFLICT) {
+                ++m_counts.conflicts;
+                break;
+            }
+            const Index slot = ChooseSlot(candidate);
+            if (slot == candidate.size()) break;
+            width *= 2;
+            ++m_counts.guesses;
+            candidate.Set(slot, (m_rng() & 1) != 0 ? YES : NO);
+        }
+    }
+    return total / static_cast<double>(probes);
+}
+
+bool Puzzle::Search::Stopping() {
+    if ((m_options.cancel != nullptr &&
+         m_options.cancel->load(std::memory_order_relaxed)) ||
+        (m_halt != nullptr && m_halt->load(std::memory_order_relaxed))) {
+        m_counts.cancelled = true;
+        return true;
+    }
+    if (m_options.node_limit != 0 && m_counts.nodes >= m_options.node_limit) {
+        m_counts.gave_up = true;
+        return true;
+    }
+    return false;
+}
+
+void Puzzle::Search::SaveCheckpoint(const Frontier &frontier,
+                                    const std::vector<Solution> &solutions) {
+    Checkpoint checkpoint;
+    checkpoint.slots = m_puzzle.m_slot_count;
+    checkpoint.constraints = m_puzzle.ConstraintCount();
+    checkpoint.fingerprint = m_fingerprint;
+    checkpoint.counts = m_counts;
+    // Run adds its time when it returns.
+    checkpoint.counts.seconds +=
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count();
+    checkpoint.run = m_run;
+    checkpoint.conflicts = frontier.conflicts;
+    checkpoint.done = frontier.done;
+    std::ostringstream rng;
+    rng << m_rng;
+    checkpoint.rng = rng.str();
+    checkpoint.weights = m_weights;
+    checkpoint.nogoods = m_nogoods;
+    for (const auto &node : frontier.candidates) {
+        checkpoint.frontier.push_back(node.path);
+    }
+    checkpoint.previous = frontier.previous;
+    checkpoint.found_before = frontier.found_before;
+    for (const auto &s : solutions) {
+        IndexList yes;
+        for (Index i = 0; i < s.size(); ++i) {
+            if (s[i] == YES) yes.push_back(i);
+        }
+        checkpoint.solutions.push_back(std::move(yes));
+    }
+    if (!WriteCheckpoint(m_options.checkpoint, checkpoint)) {
+        ++m_counts.checkpoint_failures;
+    }
+    m_checkpointed_at = m_counts.nodes;
 }
 
-Result Puzzle::ApplyConstraints(Solution &candidate) const {
+bool Puzzle::Search::LoadCheckpoint(Frontier &frontier,
+                                    std::vector<Solution> &solutions) {
+    Checkpoint checkpoint;
+    if (!ReadCheckpoint(m_options.checkpoint, checkpoint) ||
+        checkpoint.slots != m_puzzle.m_slot_count ||
+        checkpoint.constraints != m_puzzle.ConstraintCount() ||
+        !(checkpoint.fingerprint == m_fingerprint) ||
+        // Before the first node both are empty, and after it there's a
+        // count for each level of the previous guesses and for the root.
+        (checkpoint.found_before.empty()
+             ? !checkpoint.previous.empty()
+             : checkpoint.found_before.size() != checkpoint.previous.size() + 1)) {
+        return false;
+    }
+    std::istringstream rng(checkpoint.rng);
+    rng >> m_rng;
+    if (!rng) return false;
+
+    m_counts = checkpoint.counts;
+    m_counts.gave_up = false;
+    m_counts.cancelled = false;
+    m_checkpointed_at = m_counts.nodes;
+    m_run = checkpoint.run;
+    if (checkpoint.weights.size() == m_weights.size()) {
+        m_weights = std::move(checkpoint.weights);
+    }
+    m_nogoods = std::move(checkpoint.nogoods);
+
+    // Each candidate is rebuilt from the root by replaying its guesses.
+    frontier = Frontier{};
+    for (auto &path : checkpoint.frontier) {
+        Node node = m_root;
+        node.path = std::move(path);
+        frontier.candidates.push_back(std::move(node));
+    }
+    frontier.previous = std::move(checkpoint.previous);
+    frontier.found_before = std::move(checkpoint.found_before);
+    frontier.conflicts = checkpoint.conflicts;
+    frontier.done = checkpoint.done;
+
+    solutions.clear();
+    for (const auto &yes : checkpoint.solutions) {
+        Solution s(m_puzzle.m_slot_count);
+        for (const Index i : yes) s.Set(i, YES);
+        for (Index i = 0; i < s.size(); ++i) {
+            if (s[i] == MAYBE) s.Set(i, NO);
+        }
+        solutions.push_back(std::move(s));
+    }
+    return true;
+}
+
+Result Puzzle::Search::Deduce(Solution &candidate, std::size_t *culprit) {
+    Result overall = Result::NO_CHANGE;
+    for (;;) {
+        const Result result =
+            m_puzzle.Fixpoint(candidate, m_options.trace, &m_counts, culprit);
+        if (result == Result::CONFLICT) return result;
+        if (result == Result::PROGRESS) overall = result;
+        switch (ApplyNogoods(candidate)) {
+            case Result::CONFLICT:
+                // No constraint is to blame.
+                *culprit = m_puzzle.ConstraintCount();
+                return Result::CONFLICT;
+            case Result::NO_CHANGE:
+                return overall;
+            case Result::PROGRESS:
+                overall = Result::PROGRESS;
+                break;
+        }
+    }
+}
+
+// A nogood is violated when all its literals are true.  When all but one
+// are true, the last one must be false.
+Result Puzzle::Search::ApplyNogoods(Solution &candidate) {
     Result result = Result::NO_CHANGE;
+    for (const auto &nogood : m_nogoods) {
+        const Literal *open = nullptr;
+        bool satisfied = false;
+        for (const auto &literal : nogood) {
+            const Truth value = candidate[literal.index];
+            if (value == literal.value) continue;
+            if (value != MAYBE || open != nullptr) {
+                satisfied = true;
+                break;
+            }
+            open = &literal;
+        }
+        if (satisfied) continue;
+        if (open == nullptr) {
+            if (m_options.trace) std::cout << "Conflict: Learned nogood.\n";
+            return Result::CONFLICT;
+        }
+        candidate.Set(open->index, !open->value);
+        if (m_options.trace) std::cout << "Progress: Learned nogood.\n";
+        result = Result::PROGRESS;
+    }
+    return result;
+}
+
+void Puzzle::Search::Learn(const std::vector<Literal> &path,
+                           std::size_t length) {
+    if (length > m_options.nogood_length) return;
+    m_nogoods.emplace_back(path.begin(),
+                           path.begin() + static_cast<std::ptrdiff_t>(length));
+    ++m_counts.nogoods_learned;
+    Forget();
+    if (m_options.exchange != nullptr) {
+        m_options.exchange->Publish(path.data(), length, m_source);
+    }
+}
+
+void Puzzle::Search::Import() {
+    if (m_options.exchange == nullptr || m_options.nogood_length == 0) return;
+    m_counts.nogoods_imported += m_options.exchange->Import(
+        m_cursor, m_source, m_options.nogood_length, m_nogoods);
+    Forget();
+}
+
+void Puzzle::Search::Forget() {
+    if (m_nogoods.size() <= max_nogoods) return;
+    m_nogoods.erase(m_nogoods.begin(),
+                    m_nogoods.end() - static_cast<std::ptrdiff_t>(max_nogoods/2));
+}
+
+void Puzzle::Search::LoadScopes() {
+    m_starts.clear();
+    m_scopes.clear();
+    for (std::size_t c = 0; c < m_puzzle.ConstraintCount(); ++c) {
+        m_starts.push_back(m_scopes.size());
+        m_puzzle.AppendScope(c, m_scopes);
+    }
+    m_starts.push_back(m_scopes.size());
+}
+
+Index Puzzle::Search::ChooseSlot(const Solution &candidate) {
+    const std::size_t constraint_count = m_starts.empty() ? 0 : m_starts.size() - 1;
+    auto const maybes_in = [&](std::size_t c) {
+        std::size_t count = 0;
+        for (std::size_t i = m_starts[c]; i < m_starts[c+1]; ++i) {
+            if (candidate[m_scopes[i]] == MAYBE) ++count;
+        }
+        return count;
+    };
+
+    switch (m_options.branching) {
+        case Branching::FIRST_MAYBE:
+            break;
+
+        case Branching::FEWEST_MAYBES: {
+            // A constraint with only one MAYBE left isn't really a choice, so
+            // look for the tightest one with at least two.
+            std::size_t best = constraint_count;
+            std::size_t best_count = std::numeric_limits<std::size_t>::max();
+            for (std::size_t c = 0; c < constraint_count; ++c) {
+                const std::size_t count = maybes_in(c);
+                if (2 <= count && count < best_count) {
+                    best = c;
+                    best_count = count;
+                }
+            }
+            if (best == constraint_count) break;
+            for (std::size_t i = m_starts[best]; i < m_starts[best+1]; ++i) {
+                if (candidate[m_scopes[i]] == MAYBE) return m_scopes[i];
+            }
+            break;
+        }
+
+        case Branching::CONFLICT_WEIGHTED: {
+            // Each MAYBE scores the weights of the undecided constraints it
+            // appears in, and a constraint's weight counts its conflicts.
+            m_scores.assign(candidate.size(), 0);
+            for (std::size_t c = 0; c < constraint_count; ++c) {
+                if (maybes_in(c) < 2) continue;
+                for (std::size_t i = m_starts[c]; i < m_starts[c+1]; ++i) {
+                    if (candidate[m_scopes[i]] == MAYBE) {
+                        m_scores[m_scopes[i]] += m_weights[c];
+                    }
+                }
+            }
+            const auto best = std::max_element(m_scores.begin(), m_scores.end());
+            if (*best == 0) break;
+            return static_cast<Index>(best - m_scores.begin());
+        }
+
+        case Branching::RANDOM: {
+            std::size_t count = 0;
+            for (Index i = 0; i < candidate.size(); ++i) {
+                if (candidate[i] == MAYBE) ++count;
+            }
+            if (count == 0) break;
+            std::size_t pick =
+                std::uniform_int_distribution<std::size_t>(0, count - 1)(m_rng);
+            for (Index i = 0; i < candidate.size(); ++i) {
+                if (candidate[i] == MAYBE && pick-- == 0) return i;
+            }
+            break;
+        }
+    }
+    return candidate.FirstMaybe();
+}
+
+std::size_t Puzzle::Search::SnapshotInterval(std::size_t depth) const {
+    if (m_options.snapshot_interval != 0) return m_options.snapshot_interval;
+    // Snapshots every sqrt(depth) levels keep both the number of copies and
+    // the guesses to replay down to sqrt(depth).
+    std::size_t interval = 1;
+    while ((interval + 1) * (interval + 1) <= depth) ++interval;
+    return interval;
+}
+
+Truth Puzzle::Search::FirstGuess() {
+    switch (m_options.value_order) {
+        case ValueOrder::YES_FIRST: return YES;
+        case ValueOrder::NO_FIRST:  return NO;
+        case ValueOrder::RANDOM:    return (m_rng() & 1) ? YES : NO;
+    }
+    return YES;
+}
+
+Puzzle::Puzzle(std::shared_ptr<const FlatModel> model) :
+    m_slot_count(model->SlotCount()), m_flat(std::move(model)) {}
+
+std::size_t Puzzle::ConstraintCount() const {
+    return m_constraints.size() + (m_flat ? m_flat->ConstraintCount() : 0);
+}
+
+std::shared_ptr<const FlatModel> Puzzle::Flatten() const {
+    if (m_flat && m_constraints.empty()) return m_flat;
+    FlatModelBuilder builder(m_slot_count);
     for (const auto &c : m_constraints) {
-        switch (c->Evaluate(candidate)) {
+        if (!c->Flatten(builder)) return nullptr;
+    }
+    if (m_flat) builder.Append(*m_flat);
+    return builder.Build();
+}
+
+bool Puzzle::Save(const std::string &path) const {
+    const auto model = Flatten();
+    return model && model->Save(path);
+}
+
+std::vector<Solution> Puzzle::Solve(const SolveOptions &options,
+                                    SolveStatistics *stats) const {
+    Search search(*this, options);
+    auto solutions = search.Run();
+    if (stats != nullptr) *stats = search.Statistics();
+    return solutions;
+}
+
+std::vector<Solution> Puzzle::Solve(const std::vector<Literal> &assumptions,
+                                    const SolveOptions &options,
+                                    SolveStatistics *stats) const {
+    Solution root(m_slot_count);
+    for (const auto &literal : assumptions) {
+        if (root.Set(literal.index, literal.value) == Result::CONFLICT) {
+            // The assumptions contradict each other.
+            if (stats != nullptr) *stats = SolveStatistics{};
+            return {};
+        }
+    }
+    Search search(*this, options, Search::Start(std::move(root), assumptions));
+    auto solutions = search.Run();
+    if (stats != nullptr) *stats = search.Statistics();
+    return solutions;
+}
+
+double Puzzle::EstimateNodes(const SolveOptions &options, std::size_t probes,
+                             SolveStatistics *stats) const {
+    SolveOptions probing = options;
+    probing.trace = false;
+    Search search(*this, probing);
+    const double estimate = search.EstimateNodes(probes);
+    if (stats != nullptr) *stats = search.Statistics();
+    return estimate;
+}
+
+std::vector<Solution> Puzzle::SolvePortfolio(
+    const std::vector<SolveOptions> &configurations,
+    SolveStatistics *stats,
+    std::size_t *winner
+) const {
+    std::atomic<bool> done{false};
+    std::mutex mutex;
+    NogoodExchange exchange;
+    std::size_t first = configurations.size();
+    std::size_t interrupted = 0;    // by their own cancel flags
+    std::vector<Solution> solutions;
+    SolveStatistics counts;
+    counts.gave_up = true;
+
+    std::vector<std::thread> threads;
+    for (std::size_t i = 0; i < configurations.size(); ++i) {
+        threads.emplace_back([&, i]() {
+            SolveOptions options = configurations[i];
+            // Interleaved traces from several threads would be unreadable.
+            options.trace = false;
+            options.checkpoint.clear();
+            options.search_tree.clear();
+            options.progress = nullptr;
+            if (options.nogood_length != 0 && options.exchange == nullptr) {
+                options.exchange = &exchange;
+            }
+            // The caller's cancel flag stays, and the winner halts the rest.
+            Search search(*this, options);
+            search.HaltOn(&done);
+            auto found = search.Run();
+            const SolveStatistics &mine = search.Statistics();
+            std::lock_guard<std::mutex> lock(mutex);
+            if (first != configurations.size()) return;
+            if (mine.cancelled) {
+                // No winner yet, so the caller cancelled this one.
+                if (++interrupted == configurations.size()) counts = mine;
+                return;
+            }
+            if (mine.gave_up) {
+                // Report this one's statistics unless another finishes.
+                counts = mine;
+                return;
+            }
+            first = i;
+            solutions = std::move(found);
+            counts = mine;
+            done = true;
+        });
+    }
+    for (auto &thread : threads) thread.join();
+
+    if (stats != nullptr) *stats = counts;
+    if (winner != nullptr) *winner = first;
+    return solutions;
+}
+
+std::vector<Solution> Puzzle::SolveParallel(const SolveOptions &options,
+                                            std::size_t threads,
+                                            SolveStatistics *stats) const {
+    // Explore the top of the tree on this thread, without the features
+    // that would make the frontier depend on timing or history.
+    const auto start = std::chrono::steady_clock::now();
+    SolveOptions top = options;
+    top.trace = false;
+    top.restart_base = 0;
+    top.nogood_length = 0;
+    top.exchange = nullptr;
+    top.checkpoint.clear();
+    top.search_tree.clear();
+    top.progress = nullptr;
+    std::vector<Search::Subtree> frontier;
+    Search splitter(*this, top);
+    splitter.Split(options.split_depth, &frontier);
+    std::vector<Solution> shallow = splitter.Run();
+    SolveStatistics counts = splitter.Statistics();
+
+    // Workers take subtrees in order.  Once the subtrees up to some point
+    // have found enough solutions, the later ones can't contribute, so
+    // they're abandoned.
+    const std::size_t count = frontier.size();
+    std::vector<std::vector<Solution>> found(count);
+    std::vector<SolveStatistics> work(count);
+    std::vector<bool> finished(count, false);
+    std::size_t complete = 0;         // subtrees before this are finished
+    std::size_t complete_solutions = 0; // found before subtree complete
+    std::size_t counted = 0;          // shallow solutions in that count
+    std::size_t needed = count;       // subtrees that contribute
+    std::atomic<std::size_t> next{0};
+    std::atomic<bool> enough{false};
+    std::mutex mutex;
+
+    // Counts the solutions in order up to the first unfinished subtree.
+    // The shallow ones before a subtree come before any in it.
+    auto const advance = [&]() {
+        while (complete < needed) {
+            complete_solutions += frontier[complete].solutions_before - counted;
+            counted = frontier[complete].solutions_before;
+            if (options.solution_limit != 0 &&
+                complete_solutions >= options.solution_limit) {
+                needed = complete;
+                enough = true;
+                return;
+            }
+            if (!finished[complete]) return;
+            complete_solutions += found[complete].size();
+            ++complete;
+        }
+    };
+
+    auto const worker = [&]() {
+        for (;;) {
+            const std::size_t i = next++;
+            if (i >= count || enough) return;
+            SolveOptions mine = options;
+            mine.trace = false;
+            mine.exchange = nullptr;
+            mine.checkpoint.clear();
+            mine.search_tree.clear();
+            mine.progress = nullptr;
+            mine.seed = options.seed + i + 1;
+            Search search(*this, mine, std::move(frontier[i].root));
+            search.HaltOn(&enough);
+            auto solutions = search.Run();
+
+            std::lock_guard<std::mutex> lock(mutex);
+            found[i] = std::move(solutions);
+            work[i] = search.Statistics();
+            finished[i] = true;
+            advance();
+        }
+    };
+    advance();
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::thread> pool;
+    for (std::size_t t = 1; t < std::min(threads, count); ++t) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (auto &thread : pool) thread.join();
+
+    // Merge in the order a single search would have found the solutions.
+    std::vector<Solution> solutions;
+    std::size_t taken = 0;
+    for (std::size_t i = 0; i < needed; ++i) {
+        for (; taken < frontier[i].solutions_before; ++taken) {
+            solutions.push_back(std::move(shallow[taken]));
+        }
+        for (auto &s : found[i]) solutions.push_back(std::move(s));
+        const SolveStatistics &w = work[i];
+        counts.nodes += w.nodes;
+        counts.guesses += w.guesses;
+        counts.conflicts += w.conflicts;
+        counts.passes += w.passes;
+        counts.propagated += w.propagated;
+        counts.max_passes = std::max(counts.max_passes, w.max_passes);
+        // The workers' depths start at the frontier.
+        counts.max_depth = std::max(counts.max_depth, options.split_depth + w.max_depth);
+        counts.max_candidates = std::max(counts.max_candidates, w.max_candidates);
+        counts.propagation_seconds += w.propagation_seconds;
+        counts.restarts += w.restarts;
+        counts.replayed += w.replayed;
+        counts.nogoods_learned += w.nogoods_learned;
+        counts.propagation_events += w.propagation_events;
+        counts.search_events += w.search_events;
+        counts.allocations += w.allocations;
+        counts.gave_up = counts.gave_up || w.gave_up;
+        counts.cancelled = counts.cancelled || w.cancelled;
+    }
+    for (; taken < shallow.size(); ++taken) {
+        solutions.push_back(std::move(shallow[taken]));
+    }
+    if (options.solution_limit != 0 && solutions.size() > options.solution_limit) {
+        solutions.erase(solutions.begin() +
+                            static_cast<std::ptrdiff_t>(options.solution_limit),
+                        solutions.end());
+    }
+    counts.solutions = solutions.size();
+    counts.seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (stats != nullptr) *stats = counts;
+    return solutions;
+}
+
+Result Puzzle::Propagate(Solution &candidate,
+                         const SolveOptions &options,
+                         SolveStatistics *stats) const {
+    std::size_t culprit = 0;
+    return Fixpoint(candidate, options.trace, stats, &culprit);
+}
+
+Result Puzzle::Fixpoint(Solution &candidate, bool trace,
+                        SolveStatistics *stats, std::size_t *culprit) const {
+    Result overall = Result::NO_CHANGE;
+    Result result;
+    do {
+        result = ApplyConstraints(candidate, trace, culprit);
+        if (stats != nullptr) ++stats->passes;
+        if (result == Result::PROGRESS) overall = Result::PROGRESS;
+    } while (result == Result::PROGRESS);
+    return result == Result::CONFLICT ? Result::CONFLICT : overall;
+}
+
+Result Puzzle::ApplyConstraints(Solution &candidate, bool trace,
+                                std::size_t *culprit) const {
+    Result result = Result::NO_CHANGE;
+    const std::size_t count = ConstraintCount();
+    for (std::size_t i = 0; i < count; ++i) {
+        switch (Evaluate(i, candidate)) {
             case Result::CONFLICT:
-                std::cout << "Conflict: " << c->GetName() << '\n';
+                if (trace) std::cout << "Conflict: " << Name(i) << '\n';
+                *culprit = i;
                 return Result::CONFLICT;
             case Result::NO_CHANGE:
                 break;
             case Result::PROGRESS:
-                std::cout << "Progress: " << c->GetName() << '\n';
+                if (trace) std::cout << "Progress: " << Name(i) << '\n';
                 result = Result::PROGRESS;
                 break;
         }
     }
     return result;
 }
+
+Result Puzzle::Evaluate(std::size_t c, Solution &candidate) const {
+    if (c < m_constraints.size()) return m_constraints[c]->Evaluate(candidate);
+    return m_flat->Evaluate(c - m_constraints.size(), candidate);
+}
+
+void Puzzle::AppendScope(std::size_t c, IndexList &scope) const {
+    if (c < m_constraints.size()) {
+        m_constraints[c]->AppendScope(scope);
+    } else {
+        m_flat->AppendScope(c - m_constraints.size(), scope);
+    }
+}
+
+const std::string &Puzzle::Name(std::size_t c) const {
+    if (c < m_constraints.size()) return m_constraints[c]->GetName();
+    return m_flat->Name(c - m_constraints.size());
+}
+
+std::vector<SolveOptions> DefaultPortfolio(std::size_t count,
+                                           const SolveOptions &base) {
+    std::vector<SolveOptions> portfolio;
+    for (std::size_t i = 0; i < count; ++i) {
+        SolveOptions options = base;
+        switch (i) {
+            case 0:
+                break;
+            case 1:
+                options.branching = Branching::CONFLICT_WEIGHTED;
+                options.restart_base = 100;
+                break;
+            case 2:
+                options.branching = Branching::FEWEST_MAYBES;
+                break;
+            case 3:
+                options.branching = Branching::FEWEST_MAYBES;
+                options.value_order = ValueOrder::NO_FIRST;
+                break;
+            default:
+                // Randomized configurations with restarts, each differently
+                // seeded, alternating between two heuristics.
+                options.branching = (i % 2 == 0) ? Branching::RANDOM
+                                                 : Branching::CONFLICT_WEIGHTED;
+                options.value_order = ValueOrder::RANDOM;
+                options.restart_base = 50;
+                options.seed = base.seed + i;
+                break;
+        }
+        portfolio.push_back(options);
+    }
+    return portfolio;
+}
+
+std::ostream &operator<<(std::ostream &out, const SolveStatistics &stats) {
+    const auto flags = out.flags();
+    const auto precision = out.precision();
+    const double nodes = static_cast<double>(std::max<std::size_t>(stats.nodes, 1));
+    out << stats.nodes << " nodes, " << stats.guesses << " guesses, "
+        << stats.conflicts << " conflicts, " << stats.solutions << " solutions, "
+        << stats.restarts << " restarts" << (stats.gave_up ? " (gave up)" : "")
+        << (stats.cancelled ? " (cancelled)" : "") << '\n'
+        << std::fixed << std::setprecision(2)
+        << "per node: " << static_cast<double>(stats.passes) / nodes << " passes, "
+        << static_cast<double>(stats.propagated) / nodes << " slots propagated, "
+        << static_cast<double>(stats.replayed) / nodes << " guesses replayed\n"
+        << "at most: " << stats.max_passes << " passes at a node, "
+        << stats.max_depth << " guesses deep, " << stats.max_candidates
+        << " candidates waiting\n";
+    if (stats.checkpoint_failures != 0) {
+        out << "checkpoints: " << stats.checkpoint_failures << " couldn't be written\n";
+    }
+    if (stats.nogoods_learned != 0 || stats.nogoods_imported != 0) {
+        out << "nogoods: " << stats.nogoods_learned << " learned, "
+            << stats.nogoods_imported << " imported\n";
+    }
+    out << stats.seconds * 1000 << " ms";
+    if (stats.propagation_seconds > 0) {
+        out << ", " << stats.propagation_seconds * 1000 << " ms propagating";
+        if (stats.seconds > 0) {
+            out << " (" << std::setprecision(0)
+                << 100 * stats.propagation_seconds / stats.seconds << "%)";
+        }
+    }
+    out << '\n';
+    out.flags(flags);
+    out.precision(precision);
+    if (stats.propagation_events.cycles != 0 || stats.search_events.cycles != 0) {
+        out << "propagation: " << stats.propagation_events << '\n'
+            << "search: " << stats.search_events << '\n';
+    }
+    if (TrackingAllocations()) out << stats.allocations;
+    return out;
+}
@@ -2,7 +2,13 @@
 #ifndef SOLVER_H
 #define SOLVER_H
 
+#include "solver_lib/allocation_tracker.h"
+#include "solver_lib/perf_counters.h"
+
 #include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <iosfwd>
 #include <memory>
 #include <string>
 #include <vector>
@@ -15,15 +21,23 @@ using IndexList = std::vector<Index>;
 
 enum class Result { CONFLICT = -1, NO_CHANGE = 0, PROGRESS = 1 };
 
+// A slot together with a value for it.
+struct Literal {
+    Index index;
+    Truth value;
+};
+
 class Solution {
     public:
-        explicit Solution(std::size_t slots) : m_table(slots, MAYBE) {}
+        explicit Solution(std::size_t slots) :
+            m_table(slots, MAYBE), m_maybes(slots) {}
 
         Truth operator[](Index index) const { return m_table[index]; }
 
         std::size_t size() const { return m_table.size(); }
 
         Index FirstMaybe() const;
+        std::size_t Maybes() const { return m_maybes; }
 
         Result Set(Index index, Truth value);
 
@@ -31,13 +45,201 @@ class Solution {
 
     private:
         std::vector<Truth> m_table;
+        std::size_t m_maybes;
 };
 
+// How Solve picks the MAYBE to guess at.
+enum class Branching {
+    FIRST_MAYBE,        // the lowest index
+    FEWEST_MAYBES,      // in the constraint with the fewest MAYBEs left
+    CONFLICT_WEIGHTED,  // in constraints that have caused the most conflicts
+    RANDOM
+};
+
+class NogoodExchange;
+class FlatModel;
+class FlatModelBuilder;
+class ProgressListener;
+
+// Which guess Solve explores first.
+enum class ValueOrder { YES_FIRST, NO_FIRST, RANDOM };
+
+// Controls how Puzzle::Solve explores the solution space.
+struct SolveOptions {
+    // Print a trace of the constraints that make progress or conflict.
+    bool trace = true;
+    // Stop after finding this many solutions.  Zero means find them all.
+    std::size_t solution_limit = 0;
+    // Give up after examining this many candidates.  Zero means no limit.
+    std::size_t node_limit = 0;
+
+    Branching branching = Branching::FIRST_MAYBE;
+    ValueOrder value_order = ValueOrder::YES_FIRST;
+    // Start over after this many conflicts times the next number in the Luby
+    // sequence (1, 1, 2, 1, 1, 2, 4, ...).  Zero means never restart.  A
+    // restart discards the solutions found so far; they'll be found again.
+    std::size_t restart_base = 0;
+    // Seeds the random choices of the RANDOM branching and value order.
+    std::uint64_t seed = 0;
+    // When a guess leads only to conflicts, remember the guesses that led to
+    // it (a nogood) if there are at most this many, so that restarts don't
+    // explore it again.  Zero means don't learn.
+    std::size_t nogood_length = 0;
+    // Publish learned nogoods to this exchange and import those of other
+    // searches of the same puzzle.  SolvePortfolio provides one for the
+    // configurations that learn.
+    NogoodExchange *exchange = nullptr;
+    // SolveParallel splits the search into independent subtrees this many
+    // guesses deep.  The results depend on this but not on the threads.
+    std::size_t split_depth = 6;
+    // Keep a full copy of the candidate only every this many levels of
+    // guesses, and rebuild the candidates in between by replaying guesses
+    // from the nearest copy above them.  That trades propagation for memory
+    // when there are many slots and the search goes deep.  Zero adapts the
+    // interval to the depth.
+    std::size_t snapshot_interval = 1;
+    // If this names a file, Solve saves the state of the search there every
+    // checkpoint_interval nodes (if that's not zero) and when it returns.
+    std::string checkpoint;
+    std::size_t checkpoint_interval = 0;
+    // If this names a file, Solve records the search tree there (see
+    // search_tree.h).  SolvePortfolio and SolveParallel don't.
+    std::string search_tree;
+    // Continue from the checkpoint file, if it exists and is for the same
+    // puzzle.  Otherwise, start from scratch.  The node limit counts the
+    // nodes examined before the checkpoint.
+    bool resume = false;
+    // Propagate the root with PropagatePartitioned on this many threads.
+    // Fewer than two means propagate it like every other candidate.
+    std::size_t propagation_threads = 0;
+    // Count hardware events (see perf_counters.h) in propagation and in the
+    // rest of the search separately.  That costs two system calls a node.
+    // Only the search's own thread is counted, not PropagatePartitioned's.
+    bool count_events = false;
+    // Time propagation, for SolveStatistics::propagation_seconds.  That
+    // reads the clock twice a node.
+    bool time_propagation = false;
+    // Report how far along the search is, with estimates of the nodes and
+    // the time left (see progress.h), about every progress_interval
+    // seconds.  SolvePortfolio and SolveParallel don't.
+    ProgressListener *progress = nullptr;
+    double progress_interval = 1;
+    // Solve stops soon after another thread sets this flag.
+    const std::atomic<bool> *cancel = nullptr;
+};
+
+// What Solve did.  The maximums are over the whole search, the counts are
+// totals, and the times are in seconds.
+struct SolveStatistics {
+    std::size_t nodes = 0;      // candidates examined
+    std::size_t guesses = 0;
+    std::size_t conflicts = 0;
+    std::size_t solutions = 0;
+    std::size_t passes = 0;     // sweeps through all the constraints
+    std::size_t propagated = 0; // slots that propagation decided
+    std::size_t max_passes = 0; // at any one node
+    std::size_t max_depth = 0;  // guesses below the root
+    std::size_t max_candidates = 0;   // waiting on the stack at once
+    std::size_t restarts = 0;
+    std::size_t nogoods_learned = 0;
+    std::size_t nogoods_imported = 0;
+    std::size_t replayed = 0;   // guesses replayed to rebuild candidates
+    bool gave_up = false;       // stopped at the node limit
+    bool cancelled = false;
+    // Attempts to save a checkpoint that failed, as on a full disk.  The
+    // search goes on and tries again after another checkpoint_interval.
+    std::size_t checkpoint_failures = 0;
+    // With SolveOptions::count_events, where counters are available.
+    HardwareCounts propagation_events;
+    HardwareCounts search_events;   // everything but propagation
+    // Only if solver_lib tracks allocations (see allocation_tracker.h).
+    AllocationStatistics allocations;
+    // Wall time.  Propagation is only timed with
+    // SolveOptions::time_propagation, and SolveParallel adds up its threads'.
+    double seconds = 0;
+    double propagation_seconds = 0;
+};
+
+// A few lines:  the counts, the averages per node, the maximums, and the
+// time spent propagating, then the hardware events and the allocations if
+// there are any.
+std::ostream &operator<<(std::ostream &out, const SolveStatistics &stats);
+
 class Puzzle {
     public:
         explicit Puzzle(std::size_t slots) : m_slot_count(slots) {}
 
-        std::vector<Solution> Solve() const;
+        // A puzzle with the constraints of a flat model (see flat_model.h),
+        // which it evaluates in place.  Constrain can add more.
+        explicit Puzzle(std::shared_ptr<const FlatModel> model);
+
+        std::size_t SlotCount() const { return m_slot_count; }
+        std::size_t ConstraintCount() const;
+
+        // The puzzle as a flat model, or null if a constraint can't be
+        // flattened.
+        std::shared_ptr<const FlatModel> Flatten() const;
+
+        // Writes the puzzle as a flat model that Puzzle(FlatModel::Open(path))
+        // loads.  Returns false if a constraint can't be flattened or the
+        // file can't be written.
+        bool Save(const std::string &path) const;
+
+        std::vector<Solution> Solve(const SolveOptions &options = {},
+                                    SolveStatistics *stats = nullptr) const;
+
+        // Finds the solutions in which the assumptions hold.  The search
+        // treats them as guesses, so learned nogoods include them.
+        std::vector<Solution> Solve(const std::vector<Literal> &assumptions,
+                                    const SolveOptions &options,
+                                    SolveStatistics *stats = nullptr) const;
+
+        // Estimates how many nodes Solve would examine to find every
+        // solution, by Knuth's method:  each probe follows random guesses
+        // from the root to a conflict or a solution, and a leaf d guesses
+        // deep stands for a tree of 2^(d+1) - 1 nodes.  The average over
+        // the probes is unbiased but varies a lot on irregular trees, so
+        // use hundreds of probes.  Each costs about as much as one dive of
+        // the search, and the statistics count its nodes.  The options
+        // choose the slot to branch on; the value is a coin flip.
+        double EstimateNodes(const SolveOptions &options, std::size_t probes,
+                             SolveStatistics *stats = nullptr) const;
+
+        // Runs Solve with each configuration on a separate thread and returns
+        // the result of whichever finishes first, cancelling the others.
+        // Configurations that give up at their node limit don't count.  If
+        // winner isn't null, it receives the index of the configuration that
+        // finished first (or the number of configurations if none did).
+        // A configuration's cancel flag still stops it, and if every one
+        // was stopped that way, the statistics say it was cancelled.
+        std::vector<Solution> SolvePortfolio(
+            const std::vector<SolveOptions> &configurations,
+            SolveStatistics *stats = nullptr,
+            std::size_t *winner = nullptr) const;
+
+        // Splits the search into subtrees split_depth guesses deep and solves
+        // them on the given number of threads (zero means one per core).  The
+        // solutions come back in the order Solve would find them, and they
+        // and the statistics are the same for any number of threads.  Each
+        // subtree gets its own node limit and its own seed, and there's no
+        // trace.
+        std::vector<Solution> SolveParallel(const SolveOptions &options,
+                                            std::size_t threads,
+                                            SolveStatistics *stats = nullptr) const;
+
+        // Applies the constraints until they can't deduce anything more.
+        // Returns PROGRESS if anything changed.
+        Result Propagate(Solution &candidate,
+                         const SolveOptions &options = {},
+                         SolveStatistics *stats = nullptr) const;
+
+        // Like Propagate, but splits the constraints into blocks that share
+        // few slots and propagates each block on its own thread, exchanging
+        // changes to shared slots between rounds until nothing changes.
+        // This relies on AppendScope; constraints that don't override it are
+        // applied on the calling thread between rounds.  There's no trace.
+        Result PropagatePartitioned(Solution &candidate, std::size_t threads,
+                                    SolveStatistics *stats = nullptr) const;
 
         class BasicConstraint {
             public:
@@ -45,6 +247,13 @@ class Puzzle {
                     m_name(name) {}
                 virtual ~BasicConstraint() = default;
                 virtual Result Evaluate(Solution &s) const = 0;
+                // Appends the indexes the constraint depends on.  Branching
+                // heuristics that look at scopes ignore constraints that
+                // don't override this.
+                virtual void AppendScope(IndexList &) const {}
+                // Describes the constraint to the builder, returning false
+                // if it isn't one of the built-in kinds.
+                virtual bool Flatten(FlatModelBuilder &) const { return false; }
                 const std::string &GetName() const { return m_name; }
             private:
                 std::string m_name;
@@ -58,10 +267,28 @@ class Puzzle {
         }
 
     private:
-        Result ApplyConstraints(Solution &candidate) const;
+        class Search;
+
+        Result Fixpoint(Solution &candidate, bool trace,
+                        SolveStatistics *stats, std::size_t *culprit) const;
+        Result ApplyConstraints(Solution &candidate, bool trace,
+                                std::size_t *culprit) const;
+
+        // Constraints are numbered from those added with Constrain to those
+        // of the flat model.
+        Result Evaluate(std::size_t c, Solution &candidate) const;
+        void AppendScope(std::size_t c, IndexList &scope) const;
+        const std::string &Name(std::size_t c) const;
 
         std::size_t m_slot_count;
         std::vector<std::unique_ptr<BasicConstraint>> m_constraints;
+        std::shared_ptr<const FlatModel> m_flat;
 };
 
+// A mix of configurations for Puzzle::SolvePortfolio.  The first is always
+// the base configuration; the rest vary the branching, value order, restarts,
+// and seed.
+std::vector<SolveOptions> DefaultPortfolio(std::size_t count,
+                                           const SolveOptions &base = {});
+
 #endif
@@ -0,0 +1,288 @@
+#include "canonical.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace {
+
+SudokuGrid Transpose(int size, const SudokuGrid &grid) {
+    SudokuGrid result(grid.size());
+    for (int r = 0; r < size; ++r) {
+        for (int c = 0; c < size; ++c) {
+            result[static_cast<std::size_t>(c*size + r)] =
+                grid[static_cast<std::size_t>(r*size + c)];
+        }
+    }
+    return result;
+}
+
+// Looks for the least grid among the arrangements of one orientation.  The
+// columns are placed one at a time, and an arrangement is abandoned as soon
+// as no row could start the grid with the least first row so far.  With the
+// columns in place, the rows follow greedily: the next row must be the least
+// of those that may come next, numbering digits that haven't appeared yet as
+// they appear, and only ties branch.
+class Search {
+    public:
+        explicit Search(int box) :
+            m_box(box),
+            m_size(box*box),
+            m_cells(Cells()),
+            m_col_used(Lines()),
+            m_cols(Lines()),
+            m_prefix(Cells()),
+            m_prefix_labels(static_cast<std::size_t>((m_size + 1)*m_size*(m_size + 1))),
+            m_prefix_next(static_cast<std::size_t>((m_size + 1)*m_size)),
+            m_row_used(Lines()),
+            m_rows(Lines()),
+            m_options(Cells()),
+            m_values(static_cast<std::size_t>(m_size*m_size*m_size)),
+            m_labels(static_cast<std::size_t>((m_size + 1)*m_size*(m_size + 1))),
+            m_next(Cells())
+        {}
+
+        bool Found() const { return m_found; }
+        SudokuGrid Best() const {
+            SudokuGrid grid = m_best;
+            for (int &digit : grid) {
+                if (digit == Empty()) digit = 0;
+            }
+            return grid;
+        }
+        const SudokuTransform &BestTransform() const { return m_transform; }
+
+        void Run(const SudokuGrid &grid, bool transposed) {
+            m_grid = &grid;
+            m_transposed = transposed;
+            std::fill(m_prefix_labels.begin(), m_prefix_labels.end(), 0);
+            std::fill(m_prefix_next.begin(), m_prefix_next.end(), 1);
+            PlaceColumn(0);
+        }
+
+    private:
+        std::size_t Lines() const { return static_cast<std::size_t>(m_size); }
+        std::size_t Cells() const { return static_cast<std::size_t>(m_size*m_size); }
+        // Empty cells compare after every digit.
+        int Empty() const { return m_size + 1; }
+        std::size_t At(int row, int col) const { return static_cast<std::size_t>(row*m_size + col); }
+
+        // Digit labels of a row, as placed so far:  with the first p columns
+        // for PrefixLabels, and as option i of row k for Labels.
+        int *PrefixLabels(int p, int row) {
+            return &m_prefix_labels[static_cast<std::size_t>((p*m_size + row)*(m_size + 1))];
+        }
+        int *Labels(int k, int i) {
+            return &m_labels[static_cast<std::size_t>((k*m_size + i)*(m_size + 1))];
+        }
+
+        void PlaceColumn(int p) {
+            if (p == m_size) {
+                const SudokuGrid &grid = *m_grid;
+                for (int r = 0; r < m_size; ++r) {
+                    for (int c = 0; c < m_size; ++c) {
+                        m_cells[At(r, c)] = grid[At(r, m_cols[static_cast<std::size_t>(c)])];
+                    }
+                }
+                std::fill(m_row_used.begin(), m_row_used.end(), false);
+                std::fill(Labels(0, 0), Labels(0, 0) + m_size + 1, 0);
+                PlaceRow(0, m_found, Labels(0, 0), 1);
+                return;
+            }
+            const int stack = p % m_box == 0 ? -1 : m_cols[static_cast<std::size_t>(p - p % m_box)] / m_box;
+            for (int c = 0; c < m_size; ++c) {
+                if (stack < 0 ? m_col_used[static_cast<std::size_t>(c - c % m_box)]
+                              : c / m_box != stack || m_col_used[static_cast<std::size_t>(c)]) {
+                    continue;
+                }
+                // Extend every row by the column, and find the least prefix.
+                int least = -1;
+                for (int r = 0; r < m_size; ++r) {
+                    const int *labels = PrefixLabels(p, r);
+                    int *extended = PrefixLabels(p + 1, r);
+                    std::copy(labels, labels + m_size + 1, extended);
+                    int &next = m_prefix_next[static_cast<std::size_t>((p + 1)*m_size + r)];
+                    next = m_prefix_next[static_cast<std::size_t>(p*m_size + r)];
+                    const int digit = (*m_grid)[At(r, c)];
+                    int &label = extended[digit];
+                    if (digit != 0 && label == 0) label = next++;
+                    m_prefix[At(r, p)] = digit == 0 ? Empty() : label;
+                    if (least < 0 || std::lexicographical_compare(
+                            &m_prefix[At(r, 0)], &m_prefix[At(r, p + 1)],
+                            &m_prefix[At(least, 0)], &m_prefix[At(least, p + 1)])) {
+                        least = r;
+                    }
+                }
+                if (m_found && std::lexicographical_compare(
+                        m_best.begin(), m_best.begin() + p + 1,
+                        &m_prefix[At(least, 0)], &m_prefix[At(least, p + 1)])) {
+                    continue;
+                }
+                m_col_used[static_cast<std::size_t>(c)] = true;
+                m_cols[static_cast<std::size_t>(p)] = c;
+                PlaceColumn(p + 1);
+                m_col_used[static_cast<std::size_t>(c)] = false;
+            }
+        }
+
+        // Places row k, given the labels of the digits seen so far (0 for
+        // none) and the next label.  While tied is set, the rows so far equal
+        // the best grid's.  Returns true if it found a better grid.
+        bool PlaceRow(int k, bool tied, const int *labels, int next) {
+            if (k == m_size) {
+                if (tied) return false;
+                Record(labels, next);
+                return true;
+            }
+
+            // The options are the unused rows of unused bands at the start of
+            // a band, and the unused rows of the current band after that.
+            const int band = k % m_box == 0 ? -1 : m_rows[static_cast<std::size_t>(k - k % m_box)] / m_box;
+            int *rows = &m_options[At(k, 0)];
+            int count = 0;
+            int least = -1;
+            const auto values = [&](int i) { return &m_values[static_cast<std::size_t>((k*m_size + i)*m_size)]; };
+            for (int r = 0; r < m_size; ++r) {
+                if (band < 0 ? m_row_used[static_cast<std::size_t>(r - r % m_box)]
+                             : r / m_box != band || m_row_used[static_cast<std::size_t>(r)]) {
+                    continue;
+                }
+                const int i = count++;
+                rows[i] = r;
+                int *option_labels = Labels(k + 1, i);
+                std::copy(labels, labels + m_size + 1, option_labels);
+                int &option_next = m_next[At(k, i)];
+                option_next = next;
+                int *option_values = values(i);
+                for (int c = 0; c < m_size; ++c) {
+                    const int digit = m_cells[At(r, c)];
+                    int &label = option_labels[digit];
+                    if (digit != 0 && label == 0) label = option_next++;
+                    option_values[c] = digit == 0 ? Empty() : label;
+                }
+                if (least < 0 || std::lexicographical_compare(
+                        option_values, option_values + m_size,
+                        values(least), values(least) + m_size)) {
+                    least = i;
+                }
+            }
+            if (tied) {
+                const auto best = m_best.begin() + k*m_size;
+                if (std::lexicographical_compare(best, best + m_size,
+                                                 values(least), values(least) + m_size)) {
+                    return false;
+                }
+                tied = std::equal(best, best + m_size, values(least));
+            }
+
+            bool improved = false;
+            for (int i = 0; i < count; ++i) {
+                if (!std::equal(values(i), values(i) + m_size, values(least))) continue;
+                m_row_used[static_cast<std::size_t>(rows[i])] = true;
+                m_rows[static_cast<std::size_t>(k)] = rows[i];
+                if (PlaceRow(k + 1, tied, Labels(k + 1, i), m_next[At(k, i)])) {
+                    // The new best shares this prefix, so the remaining ties
+                    // can at most equal it so far.
+                    improved = true;
+                    tied = true;
+                }
+                m_row_used[static_cast<std::size_t>(rows[i])] = false;
+            }
+            return improved;
+        }
+
+        void Record(const int *labels, int next) {
+            m_found = true;
+            m_best.resize(Cells());
+            std::vector<int> digits(labels, labels + m_size + 1);
+            for (int k = 0; k < m_size; ++k) {
+                const int r = m_rows[static_cast<std::size_t>(k)];
+                for (int c = 0; c < m_size; ++c) {
+                    const int digit = m_cells[At(r, c)];
+                    m_best[At(k, c)] = digit == 0 ? Empty() : digits[static_cast<std::size_t>(digit)];
+                }
+            }
+            // Digits that don't appear take the remaining labels in order.
+            for (std::size_t d = 1; d < digits.size(); ++d) {
+                if (digits[d] == 0) digits[d] = next++;
+            }
+            m_transform.transposed = m_transposed;
+            m_transform.rows = m_rows;
+            m_transform.cols = m_cols;
+            m_transform.digits = std::move(digits);
+        }
+
+        int m_box;
+        int m_size;
+        const SudokuGrid *m_grid = nullptr;
+        bool m_transposed = false;
+        // The grid with its columns in the order being tried.
+        SudokuGrid m_cells;
+
+        // Placing columns:  m_prefix holds each row's labeled digits in the
+        // columns placed so far.
+        std::vector<bool> m_col_used;
+        std::vector<int> m_cols;
+        std::vector<int> m_prefix;
+        std::vector<int> m_prefix_labels;
+        std::vector<int> m_prefix_next;
+
+        // Placing rows:  the options for each row, with their labeled digits
+        // and the labels after them.
+        std::vector<bool> m_row_used;
+        std::vector<int> m_rows;
+        std::vector<int> m_options;
+        std::vector<int> m_values;
+        std::vector<int> m_labels;
+        std::vector<int> m_next;
+
+        bool m_found = false;
+        SudokuGrid m_best;
+        SudokuTransform m_transform;
+};
+
+}
+
+SudokuGrid CanonicalSudoku(int box, const SudokuGrid &grid, SudokuTransform *transform) {
+    const int size = box*box;
+    assert(grid.size() == static_cast<std::size_t>(size*size));
+    Search search(box);
+    search.Run(grid, false);
+    search.Run(Transpose(size, grid), true);
+    assert(search.Found());
+    if (transform != nullptr) *transform = search.BestTransform();
+    return search.Best();
+}
+
+SudokuGrid ApplyTransform(int box, const SudokuGrid &grid, const SudokuTransform &transform) {
+    const int size = box*box;
+    const auto oriented = transform.transposed ? Transpose(size, grid) : grid;
+    SudokuGrid result(grid.size());
+    for (int r = 0; r < size; ++r) {
+        for (int c = 0; c < size; ++c) {
+            const int digit = oriented[static_cast<std::size_t>(
+                transform.rows[static_cast<std::size_t>(r)]*size +
+                transform.cols[static_cast<std::size_t>(c)])];
+            result[static_cast<std::size_t>(r*size + c)] =
+                transform.digits[static_cast<std::size_t>(digit)];
+        }
+    }
+    return result;
+}
+
+SudokuGrid UndoTransform(int box, const SudokuGrid &grid, const SudokuTransform &transform) {
+    const int size = box*box;
+    std::vector<int> digits(transform.digits.size());
+    for (std::size_t d = 0; d < digits.size(); ++d) {
+        digits[static_cast<std::size_t>(transform.digits[d])] = static_cast<int>(d);
+    }
+    SudokuGrid oriented(grid.size());
+    for (int r = 0; r < size; ++r) {
+        for (int c = 0; c < size; ++c) {
+            oriented[static_cast<std::size_t>(
+                transform.rows[static_cast<std::size_t>(r)]*size +
+                transform.cols[static_cast<std::size_t>(c)])] =
+                digits[static_cast<std::size_t>(grid[static_cast<std::size_t>(r*size + c)])];
+        }
+    }
+    return transform.transposed ? Transpose(size, oriented) : oriented;
+}
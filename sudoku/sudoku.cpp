@@ -1,104 +1,505 @@
+#include "canonical.h"
+#include "solver_lib/bench_results.h"
 #include "solver_lib/constraints.h"
+#include "solver_lib/probing.h"
+#include "solver_lib/result_cache.h"
 #include "solver_lib/solver.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
 #include <iostream>
+#include <numeric>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
 
-constexpr Index IndexOf(int row, int col, int val) {
-    return (row-1)*81 + (col-1)*9 + val-1;
+// A Sudoku with boxes of n x n cells has n^2 rows, n^2 columns, and n^2
+// digits.  The classic puzzle has n = 3.
+class Sudoku {
+    public:
+        explicit Sudoku(int box) : m_box(box), m_size(box*box) {}
+
+        int Size() const { return m_size; }
+        std::size_t SlotCount() const {
+            return static_cast<std::size_t>(m_size) * m_size * m_size;
+        }
+
+        Index IndexOf(int row, int col, int val) const {
+            return static_cast<Index>(((row-1)*m_size + (col-1))*m_size + val-1);
+        }
+
+        IndexList Row(int row, int val) const {
+            IndexList result;
+            for (int col = 1; col <= m_size; ++col) {
+                result.push_back(IndexOf(row, col, val));
+            }
+            return result;
+        }
+
+        IndexList Col(int col, int val) const {
+            IndexList result;
+            for (int row = 1; row <= m_size; ++row) {
+                result.push_back(IndexOf(row, col, val));
+            }
+            return result;
+        }
+
+        IndexList Cell(int row, int col) const {
+            IndexList result;
+            for (int val = 1; val <= m_size; ++val) {
+                result.push_back(IndexOf(row, col, val));
+            }
+            return result;
+        }
+
+        IndexList Box(int box, int val) const {
+            IndexList result;
+            int const row0 = m_box * ((box-1)/m_box) + 1;
+            int const row1 = row0 + m_box;
+            int const col0 = m_box * ((box-1)%m_box) + 1;
+            int const col1 = col0 + m_box;
+            for (int row = row0; row < row1; ++row) {
+                for (int col = col0; col < col1; ++col) {
+                    result.push_back(IndexOf(row, col, val));
+                }
+            }
+            return result;
+        }
+
+        // Basic Sudoku rules.
+        void AddRules(Puzzle &puzzle) const {
+            for (int i = 1; i <= m_size; ++i) {
+                for (int j = 1; j <= m_size; ++j) {
+                    puzzle.Constrain<ExactlyNOf>("Cell has exactly 1 digit.", 1, Cell(i, j));
+                    puzzle.Constrain<ExactlyNOf>("Digit appears exactly once in row.", 1, Row(i, j));
+                    puzzle.Constrain<ExactlyNOf>("Digit appears exactly once in column.", 1, Col(i, j));
+                    puzzle.Constrain<ExactlyNOf>("Digit appears exactly once in box.", 1, Box(i, j));
+                }
+            }
+        }
+
+        // A grid lists the digits row by row, with 0 for an empty cell.
+        using Grid = std::vector<int>;
+
+        void AddGivens(Puzzle &puzzle, const Grid &grid) const {
+            for (int row = 1; row <= m_size; ++row) {
+                for (int col = 1; col <= m_size; ++col) {
+                    const int val = grid[static_cast<std::size_t>((row-1)*m_size + col-1)];
+                    if (val != 0) {
+                        puzzle.Constrain<Fixed>("Fixed", IndexOf(row, col, val));
+                    }
+                }
+            }
+        }
+
+        // Makes a random solved grid by shuffling a simple valid pattern.
+        Grid RandomSolution(std::mt19937 &rng) const {
+            auto const shuffled = [&rng](int count) {
+                std::vector<int> order(static_cast<std::size_t>(count));
+                std::iota(order.begin(), order.end(), 0);
+                std::shuffle(order.begin(), order.end(), rng);
+                return order;
+            };
+            // Rows (and columns) may be permuted within a band, and the bands
+            // may be permuted.
+            auto const lines = [&]() {
+                std::vector<int> result;
+                for (int band : shuffled(m_box)) {
+                    for (int line : shuffled(m_box)) {
+                        result.push_back(band*m_box + line);
+                    }
+                }
+                return result;
+            };
+            const auto rows = lines();
+            const auto cols = lines();
+            const auto digits = shuffled(m_size);
+            Grid grid;
+            for (int r : rows) {
+                for (int c : cols) {
+                    const int pattern = (m_box*(r % m_box) + r/m_box + c) % m_size;
+                    grid.push_back(digits[static_cast<std::size_t>(pattern)] + 1);
+                }
+            }
+            return grid;
+        }
+
+        // The digits of a solution, 0 where none is YES.
+        Grid ToGrid(const Solution &s) const {
+            Grid grid;
+            for (int row = 1; row <= m_size; ++row) {
+                for (int col = 1; col <= m_size; ++col) {
+                    int digit = 0;
+                    for (int val = 1; val <= m_size; ++val) {
+                        if (s[IndexOf(row, col, val)] == YES) digit = val;
+                    }
+                    grid.push_back(digit);
+                }
+            }
+            return grid;
+        }
+
+        void Print(std::ostream &out, const Solution &s) const {
+            const int width = m_size < 10 ? 1 : 2;
+            for (int row = 1; row <= m_size; ++row) {
+                for (int col = 1; col <= m_size; ++col) {
+                    int digit = 0;
+                    for (int val = 1; val <= m_size; ++val) {
+                        if (s[IndexOf(row, col, val)] == YES) {
+                            digit = val;
+                            break;
+                        }
+                    }
+                    out << std::setw(width);
+                    if (digit == 0) out << '.'; else out << digit;
+                    out.put(' ');
+                }
+                out.put('\n');
+            }
+        }
+
+    private:
+        int m_box;
+        int m_size;
+};
+
+namespace {
+
+double MillisecondsSince(std::chrono::steady_clock::time_point start) {
+    const std::chrono::duration<double, std::milli> elapsed =
+        std::chrono::steady_clock::now() - start;
+    return elapsed.count();
 }
 
-IndexList Row(int row, int val) {
-    IndexList result;
-    for (int col = 1; col < 10; ++col) {
-        result.push_back(IndexOf(row, col, val));
+// Measures how propagation and search scale with the box size.
+//
+// Usage: sudoku bench [--boxes n,...] [--holes fraction] [--seeds K]
+//                     [--node-limit L] [--probe T] [--propagate T] [--events]
+//                     [--allocations] [--repeat R] [--json FILE]
+//
+// Each puzzle is a random solved grid with a fraction of its cells emptied,
+// so it has at least one solution but might have more.  The search stops at
+// the first one.  With --probe, the root is probed on T threads first, and
+// the search starts from the values that probing forced.  With --propagate,
+// the root is propagated in blocks on T threads.  With --events, each row is
+// followed by hardware event counts for propagation and the rest of the
+// search.  With --allocations, it's followed by the heap allocations of
+// building the puzzle and of each phase of the search, if solver_lib was
+// compiled with SOLVER_TRACK_ALLOCATIONS.  With --repeat, each search runs R
+// times and the table shows the mean.  With --json, the times, nodes, and
+// peak memory of the searches go to FILE as well, for bench_compare.
+int Benchmark(int argc, char *argv[]) {
+    std::vector<int> boxes = {3, 4, 5, 6};
+    double holes = 0.6;
+    std::size_t seeds = 3;
+    std::size_t probe_threads = 0;
+    std::size_t repeat = 1;
+    const char *json_path = nullptr;
+    bool allocations = false;
+    SolveOptions options;
+    options.trace = false;
+    options.solution_limit = 1;
+    options.node_limit = 5000;
+    for (int i = 2; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--events") == 0) {
+            options.count_events = true;
+            continue;
+        }
+        if (std::strcmp(argv[i], "--allocations") == 0) {
+            allocations = true;
+            continue;
+        }
+        if (i + 1 == argc) {
+            std::cerr << "Missing value for " << argv[i] << '\n';
+            return 1;
+        }
+        const char *value = argv[++i];
+        if (std::strcmp(argv[i - 1], "--boxes") == 0) {
+            boxes.clear();
+            for (const char *p = value; *p != '\0'; ) {
+                char *end = nullptr;
+                boxes.push_back(static_cast<int>(std::strtol(p, &end, 10)));
+                if (end == p) break;
+                p = (*end == ',') ? end + 1 : end;
+            }
+        } else if (std::strcmp(argv[i - 1], "--holes") == 0) {
+            holes = std::strtod(value, nullptr);
+        } else if (std::strcmp(argv[i - 1], "--seeds") == 0) {
+            seeds = std::strtoull(value, nullptr, 10);
+        } else if (std::strcmp(argv[i - 1], "--node-limit") == 0) {
+            options.node_limit = std::strtoull(value, nullptr, 10);
+        } else if (std::strcmp(argv[i - 1], "--propagate") == 0) {
+            options.propagation_threads = std::strtoull(value, nullptr, 10);
+        } else if (std::strcmp(argv[i - 1], "--probe") == 0) {
+            probe_threads = std::strtoull(value, nullptr, 10);
+        } else if (std::strcmp(argv[i - 1], "--repeat") == 0) {
+            repeat = std::max<std::size_t>(1, std::strtoull(value, nullptr, 10));
+        } else if (std::strcmp(argv[i - 1], "--json") == 0) {
+            json_path = value;
+        } else {
+            std::cerr << "Unknown option " << argv[i - 1] << '\n';
+            return 1;
+        }
+    }
+    if (options.count_events && !PerfCounters().Available()) {
+        std::cerr << "Hardware counters aren't available here.\n";
+        options.count_events = false;
+    }
+    if (allocations && !TrackingAllocations()) {
+        std::cerr << "solver_lib wasn't compiled with SOLVER_TRACK_ALLOCATIONS.\n";
+        allocations = false;
     }
-    return result;
-}
 
-IndexList Col(int col, int val) {
-    IndexList result;
-    for (int row = 1; row < 10; ++row) {
-        result.push_back(IndexOf(row, col, val));
+    // The suite is the command, less where the results go.
+    BenchResults results;
+    results.suite = "sudoku bench";
+    for (int i = 2; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--json") == 0) {
+            ++i;
+        } else {
+            results.suite += std::string(" ") + argv[i];
+        }
     }
-    return result;
-}
+    std::cout << " n   size   slots  givens   build ms  root ms  root passes"
+                 " probe ms  forced   solve ms    nodes  guesses   passes  gave up\n";
+    for (const int box : boxes) {
+        if (box < 1) continue;
+        const Sudoku sudoku(box);
+        for (std::size_t seed = 1; seed <= seeds; ++seed) {
+            std::mt19937 rng(static_cast<std::mt19937::result_type>(seed));
+            auto grid = sudoku.RandomSolution(rng);
+            std::size_t givens = 0;
+            std::bernoulli_distribution empty(holes);
+            for (auto &digit : grid) {
+                if (empty(rng)) digit = 0; else ++givens;
+            }
+
+            const AllocationTracker tracker;
+            const auto build_start = std::chrono::steady_clock::now();
+            Puzzle puzzle(sudoku.SlotCount());
+            sudoku.AddRules(puzzle);
+            sudoku.AddGivens(puzzle, grid);
+            const double build_ms = MillisecondsSince(build_start);
+            const AllocationCounts construction = tracker.Statistics().construction;
+
+            // Propagation alone, from the root.
+            SolveStatistics root;
+            Solution candidate(sudoku.SlotCount());
+            const auto root_start = std::chrono::steady_clock::now();
+            if (options.propagation_threads > 1) {
+                puzzle.PropagatePartitioned(candidate,
+                                            options.propagation_threads, &root);
+            } else {
+                puzzle.Propagate(candidate, options, &root);
+            }
+            const double root_ms = MillisecondsSince(root_start);
+
+            double probe_ms = 0.0;
+            ProbeResult probed;
+            if (probe_threads != 0) {
+                const auto probe_start = std::chrono::steady_clock::now();
+                probed = ProbeRoot(puzzle, candidate, probe_threads);
+                probe_ms = MillisecondsSince(probe_start);
+            }
+
+            // The full search, which repeats the root propagation.
+            SolveStatistics stats;
+            BenchResult result;
+            result.name = "sudoku/" + std::to_string(box) + '/' + std::to_string(seed);
+            double solve_ms = 0.0;
+            for (std::size_t run = 0; run < repeat; ++run) {
+                const auto solve_start = std::chrono::steady_clock::now();
+                puzzle.Solve(probed.forced, options, &stats);
+                result.milliseconds.push_back(MillisecondsSince(solve_start));
+                solve_ms += result.milliseconds.back() / static_cast<double>(repeat);
+            }
+            result.nodes = stats.nodes;
+            result.peak_bytes = stats.allocations.PeakBytes();
+            results.benchmarks.push_back(std::move(result));
 
-IndexList Cell(int row, int col) {
-    IndexList result;
-    for (int val = 1; val < 10; ++val) {
-        result.push_back(IndexOf(row, col, val));
+            std::cout << std::fixed << std::setprecision(2)
+                      << std::setw(2) << box << ' '
+                      << std::setw(6) << sudoku.Size() << ' '
+                      << std::setw(7) << sudoku.SlotCount() << ' '
+                      << std::setw(7) << givens << ' '
+                      << std::setw(10) << build_ms << ' '
+                      << std::setw(8) << root_ms << ' '
+                      << std::setw(12) << root.passes << ' '
+                      << std::setw(8) << probe_ms << ' '
+                      << std::setw(7) << probed.forced.size() << ' '
+                      << std::setw(10) << solve_ms << ' '
+                      << std::setw(8) << stats.nodes << ' '
+                      << std::setw(8) << stats.guesses << ' '
+                      << std::setw(8) << stats.passes << ' '
+                      << std::setw(8) << (stats.gave_up ? "yes" : "no")
+                      << std::endl;
+            if (options.count_events) {
+                std::cout << "    propagation: " << stats.propagation_events
+                          << "\n    search:      " << stats.search_events << '\n';
+            }
+            if (allocations) {
+                AllocationStatistics counts = stats.allocations;
+                counts.construction = construction;
+                std::cout << counts;
+            }
+        }
     }
-    return result;
+    if (json_path != nullptr && !WriteBenchResults(json_path, results)) {
+        std::cerr << "Can't write " << json_path << '\n';
+        return 1;
+    }
+    return 0;
 }
 
-IndexList Box(int box, int val) {
-    IndexList result;
-    int const row0 = 3 * ((box-1)/3) + 1;
-    int const row1 = row0 + 3;
-    int const col0 = 3 * ((box-1)%3) + 1;
-    int const col1 = col0 + 3;
-    for (int row = row0; row < row1; ++row) {
-        for (int col = col0; col < col1; ++col) {
-            result.push_back(IndexOf(row, col, val));
+// Reads a 9x9 grid written on one line, with '.' or '0' for an empty cell.
+bool ParseGrid(const std::string &line, Sudoku::Grid &grid) {
+    grid.clear();
+    for (const char ch : line) {
+        if (ch == '.' || ch == '0') {
+            grid.push_back(0);
+        } else if (ch >= '1' && ch <= '9') {
+            grid.push_back(ch - '0');
+        } else if (ch != ' ' && ch != '\t' && ch != '\r') {
+            return false;
         }
     }
-    return result;
+    return grid.size() == 81;
 }
 
-std::ostream &operator<<(std::ostream &out, Solution const &s) {
-    for (int row = 1; row < 10; ++row) {
-        for (int col = 1; col < 10; ++col) {
-            for (int val = 1; val < 10; ++val) {
-                if (s[IndexOf(row, col, val)] == YES) {
-                    out << val;
-                    break;
-                }
+std::string FormatGrid(const Sudoku::Grid &grid) {
+    std::string line;
+    for (const int digit : grid) line.push_back(digit == 0 ? '.' : static_cast<char>('0' + digit));
+    return line;
+}
+
+// Puts 9x9 puzzles in canonical form (see canonical.h).
+//
+// Usage: sudoku canon [--unique] [--solve] [--cache FILE] < puzzles
+//
+// Reads one puzzle per line and writes its canonical form.  With --unique,
+// only the first puzzle of each class is written.  With --solve, the
+// canonical form is solved instead, through a result cache, and the
+// solution is mapped back to the puzzle as given and written in its place,
+// so equivalent puzzles are solved once.
+int Canonicalize(int argc, char *argv[]) {
+    bool unique = false;
+    bool solve = false;
+    const char *cache_path = nullptr;
+    for (int i = 2; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--unique") == 0) {
+            unique = true;
+        } else if (std::strcmp(argv[i], "--solve") == 0) {
+            solve = true;
+        } else if (std::strcmp(argv[i], "--cache") == 0 && i + 1 < argc) {
+            cache_path = argv[++i];
+        } else {
+            std::cerr << "Unknown option " << argv[i] << '\n';
+            return 1;
+        }
+    }
+    ResultCache cache(1 << 16, cache_path != nullptr ? cache_path : "");
+    if (cache_path != nullptr && !cache.Persistent()) {
+        std::cerr << "Can't use " << cache_path << " as a cache.\n";
+        return 1;
+    }
+
+    const Sudoku sudoku(3);
+    SolveOptions options;
+    options.trace = false;
+    options.solution_limit = 1;
+    std::set<Sudoku::Grid> seen;
+    std::size_t count = 0;
+    double canon_ms = 0;
+    int status = 0;
+    std::string line;
+    for (std::size_t number = 1; std::getline(std::cin, line); ++number) {
+        Sudoku::Grid grid;
+        if (!ParseGrid(line, grid)) {
+            if (line.find_first_not_of(" \t\r") != std::string::npos) {
+                std::cerr << "Line " << number << ": not a 9x9 grid\n";
+                status = 1;
             }
-            out.put(' ');
+            continue;
+        }
+        ++count;
+        const auto start = std::chrono::steady_clock::now();
+        SudokuTransform transform;
+        const auto canonical = CanonicalSudoku(3, grid, &transform);
+        canon_ms += MillisecondsSince(start);
+        const bool first = seen.insert(canonical).second;
+        if (unique && !first) continue;
+        if (!solve) {
+            std::cout << FormatGrid(canonical) << '\n';
+            continue;
         }
-        out.put('\n');
+        Puzzle puzzle(sudoku.SlotCount());
+        sudoku.AddRules(puzzle);
+        sudoku.AddGivens(puzzle, canonical);
+        const auto solutions = cache.Solve(puzzle, {}, options);
+        if (solutions.empty()) {
+            std::cout << "none\n";
+        } else {
+            std::cout << FormatGrid(UndoTransform(3, sudoku.ToGrid(solutions[0]),
+                                                  transform)) << '\n';
+        }
+    }
+    const auto counts = cache.GetCounts();
+    std::cerr << count << " puzzles, " << seen.size() << " distinct, "
+              << std::fixed << std::setprecision(3)
+              << (count == 0 ? 0.0 : canon_ms / static_cast<double>(count))
+              << " ms per canonical form";
+    if (solve) {
+        std::cerr << ", " << counts.hits + counts.disk_hits << " cache hits, "
+                  << counts.misses << " misses";
     }
-    return out;
+    std::cerr << '\n';
+    return status;
 }
 
-int main() {
-    Puzzle puzzle(9*9*9);
+}
 
-    // Basic Sudoku rules:
-    for (int i = 1; i < 10; ++i) {
-        for (int j = 1; j < 10; ++j) {
-            puzzle.Constrain<ExactlyNOf>("Cell has exactly 1 digit.", 1, Cell(i, j));
-            puzzle.Constrain<ExactlyNOf>("Digit appears exactly once in row.", 1, Row(i, j));
-            puzzle.Constrain<ExactlyNOf>("Digit appears exactly once in column.", 1, Col(i, j));
-            puzzle.Constrain<ExactlyNOf>("Digit appears exactly once in box.", 1, Box(i, j));
-        }
+int main(int argc, char *argv[]) {
+    if (argc > 1 && std::strcmp(argv[1], "bench") == 0) {
+        return Benchmark(argc, argv);
     }
+    if (argc > 1 && std::strcmp(argv[1], "canon") == 0) {
+        return Canonicalize(argc, argv);
+    }
+
+    const Sudoku sudoku(3);
+    Puzzle puzzle(sudoku.SlotCount());
+    sudoku.AddRules(puzzle);
 
     // Pre-filled cells in the puzzle.
     // I found this "easy" example online.  It turns out that the solution can
     // be deduced without the solver guessing at all.  I should probably find a
     // more difficult example for testing.
-    puzzle.Constrain<Fixed>("Fixed", IndexOf(2, 6, 3));
-    puzzle.Constrain<Fixed>("Fixed", IndexOf(2, 8, 8));
-    puzzle.Constrain<Fixed>("Fixed", IndexOf(2, 9, 5));
-    puzzle.Constrain<Fixed>("Fixed", IndexOf(3, 3, 1));
-    puzzle.Constrain<Fixed>("Fixed", IndexOf(3, 5, 2));
-    puzzle.Constrain<Fixed>("Fixed", IndexOf(4, 4, 5));
-    puzzle.Constrain<Fixed>("Fixed", IndexOf(4, 6, 7));
-    puzzle.Constrain<Fixed>("Fixed", IndexOf(5, 3, 4));
-    puzzle.Constrain<Fixed>("Fixed", IndexOf(5, 7, 1));
-    puzzle.Constrain<Fixed>("Fixed", IndexOf(6, 2, 9));
-    puzzle.Constrain<Fixed>("Fixed", IndexOf(7, 1, 5));
-    puzzle.Constrain<Fixed>("Fixed", IndexOf(7, 8, 7));
-    puzzle.Constrain<Fixed>("Fixed", IndexOf(7, 9, 3));
-    puzzle.Constrain<Fixed>("Fixed", IndexOf(8, 3, 2));
-    puzzle.Constrain<Fixed>("Fixed", IndexOf(8, 5, 1));
-    puzzle.Constrain<Fixed>("Fixed", IndexOf(9, 5, 4));
-    puzzle.Constrain<Fixed>("Fixed", IndexOf(9, 9, 9));
+    puzzle.Constrain<Fixed>("Fixed", sudoku.IndexOf(2, 6, 3));
+    puzzle.Constrain<Fixed>("Fixed", sudoku.IndexOf(2, 8, 8));
+    puzzle.Constrain<Fixed>("Fixed", sudoku.IndexOf(2, 9, 5));
+    puzzle.Constrain<Fixed>("Fixed", sudoku.IndexOf(3, 3, 1));
+    puzzle.Constrain<Fixed>("Fixed", sudoku.IndexOf(3, 5, 2));
+    puzzle.Constrain<Fixed>("Fixed", sudoku.IndexOf(4, 4, 5));
+    puzzle.Constrain<Fixed>("Fixed", sudoku.IndexOf(4, 6, 7));
+    puzzle.Constrain<Fixed>("Fixed", sudoku.IndexOf(5, 3, 4));
+    puzzle.Constrain<Fixed>("Fixed", sudoku.IndexOf(5, 7, 1));
+    puzzle.Constrain<Fixed>("Fixed", sudoku.IndexOf(6, 2, 9));
+    puzzle.Constrain<Fixed>("Fixed", sudoku.IndexOf(7, 1, 5));
+    puzzle.Constrain<Fixed>("Fixed", sudoku.IndexOf(7, 8, 7));
+    puzzle.Constrain<Fixed>("Fixed", sudoku.IndexOf(7, 9, 3));
+    puzzle.Constrain<Fixed>("Fixed", sudoku.IndexOf(8, 3, 2));
+    puzzle.Constrain<Fixed>("Fixed", sudoku.IndexOf(8, 5, 1));
+    puzzle.Constrain<Fixed>("Fixed", sudoku.IndexOf(9, 5, 4));
+    puzzle.Constrain<Fixed>("Fixed", sudoku.IndexOf(9, 9, 9));
 
     const auto solutions = puzzle.Solve();
     for (const auto &solution : solutions) {
-        std::cout << solution << '\n';
+        sudoku.Print(std::cout, solution);
+        std::cout << '\n';
     }
     return 0;
 }